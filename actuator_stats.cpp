@@ -0,0 +1,171 @@
+/**
+ * ============================================================================
+ * ACTUATOR_STATS.CPP - Persistent Actuator Runtime and Wear Counters
+ * ============================================================================
+ */
+
+#include "actuator_stats.h"
+#include "debug.hpp"
+#include "dose_ledger.h"
+#include "hardware.h"
+#include "storage.h"
+#include <Arduino.h>
+
+namespace {
+
+constexpr uint32_t SECONDS_PER_DAY = 86400UL;
+constexpr uint8_t FLUSH_IDLE = 0xFF;
+
+// Persisted part, one record per actuator
+struct ActuatorRecord {
+  uint32_t onTimeS;
+  uint32_t starts;
+  uint32_t longestRunMs;
+  uint32_t day;    // Dose clock day that dayOnS belongs to
+  uint32_t dayOnS;
+  uint16_t yesterdayPermille;
+};
+
+constexpr uint16_t RECORD_STRIDE = recordFootprint(sizeof(ActuatorRecord));
+static_assert(EepromMap::ACTUATOR_STATS_ADDR + ACTUATOR_COUNT * RECORD_STRIDE <=
+                  EepromMap::ACTUATOR_STATS_END,
+              "actuator records overflow their EEPROM area");
+
+struct Actuator {
+  ActuatorRecord rec;
+  uint16_t pendingMs;   // On-time below one second, not in onTimeS yet
+  uint32_t runStartMs;  // millis() at switch-on
+  uint32_t countedToMs; // millis() up to which the run is counted
+  bool on;
+  bool dirty;           // Changed since its last flush
+};
+
+Actuator actuators[ACTUATOR_COUNT];
+uint32_t lastFlushMs = 0;
+uint8_t flushCursor = FLUSH_IDLE; // Next actuator of the batch being written
+
+const char *const NAMES[ACTUATOR_COUNT] = {"dose1", "dose2", "dose3", "inlet", "outlet", "light"};
+static_assert(ACTUATOR_COUNT == 6, "actuator names must match the relay table");
+
+uint16_t permille(uint32_t onS, uint32_t ofS) {
+  if (ofS == 0)
+    return 0;
+  uint32_t value = onS * 1000UL / ofS; // onS <= one day: fits 32 bits
+  return value > 1000 ? 1000 : static_cast<uint16_t>(value);
+}
+
+// Starts a new day window; yesterday's duty is 0 unless the window was the
+// previous day.
+void rollDay(Actuator &a, uint32_t today) {
+  if (a.rec.day == today)
+    return;
+  a.rec.yesterdayPermille = today == a.rec.day + 1 ? permille(a.rec.dayOnS, SECONDS_PER_DAY) : 0;
+  a.rec.day = today;
+  a.rec.dayOnS = 0;
+  a.dirty = true;
+}
+
+// Counts a running actuator's on-time up to `nowMs`.
+void countRun(Actuator &a, uint32_t nowMs) {
+  rollDay(a, doseClockNow() / SECONDS_PER_DAY);
+  if (!a.on)
+    return;
+  uint32_t total = a.pendingMs + (nowMs - a.countedToMs);
+  a.countedToMs = nowMs;
+  a.pendingMs = static_cast<uint16_t>(total % 1000UL);
+  uint32_t wholeSeconds = total / 1000UL;
+  if (wholeSeconds == 0)
+    return;
+  a.rec.onTimeS += wholeSeconds;
+  a.rec.dayOnS += wholeSeconds;
+  a.dirty = true;
+}
+
+uint16_t recordAddress(uint8_t actuator) {
+  return EepromMap::ACTUATOR_STATS_ADDR + actuator * RECORD_STRIDE;
+}
+
+} // namespace
+
+namespace ActuatorStats {
+
+void init() {
+  uint32_t today = doseClockNow() / SECONDS_PER_DAY;
+  uint8_t restored = 0;
+  for (uint8_t i = 0; i < ACTUATOR_COUNT; i++) {
+    Actuator &a = actuators[i];
+    memset(&a, 0, sizeof(a));
+    if (loadRecord(recordAddress(i), &a.rec, sizeof(a.rec)))
+      restored++;
+    else
+      a.rec.day = today;
+  }
+  lastFlushMs = millis();
+  SerialPrint(PUMPS, "Actuator counters restored=", restored, "/", ACTUATOR_COUNT);
+}
+
+void switched(uint8_t actuator, bool on) {
+  if (actuator >= ACTUATOR_COUNT || actuators[actuator].on == on)
+    return;
+  Actuator &a = actuators[actuator];
+  uint32_t nowMs = millis();
+  countRun(a, nowMs);
+  a.on = on;
+  a.dirty = true;
+  if (on) {
+    a.rec.starts++;
+    a.runStartMs = nowMs;
+    a.countedToMs = nowMs;
+  } else if (nowMs - a.runStartMs > a.rec.longestRunMs) {
+    a.rec.longestRunMs = nowMs - a.runStartMs;
+  }
+}
+
+// One record per call, so a batch never blocks the loop for more than one
+// record's EEPROM writes.
+void flushDue() {
+  uint32_t nowMs = millis();
+  if (flushCursor == FLUSH_IDLE) {
+    if (nowMs - lastFlushMs < Hardware::ACTUATOR_STATS_FLUSH_S * 1000UL)
+      return;
+    lastFlushMs = nowMs;
+    flushCursor = 0;
+  }
+  for (; flushCursor < ACTUATOR_COUNT; flushCursor++) {
+    Actuator &a = actuators[flushCursor];
+    countRun(a, nowMs);
+    if (!a.dirty)
+      continue;
+    a.dirty = false;
+    storeRecord(recordAddress(flushCursor), &a.rec, sizeof(a.rec));
+    flushCursor++;
+    return;
+  }
+  flushCursor = FLUSH_IDLE;
+}
+
+bool get(uint8_t actuator, ActuatorCounters *counters) {
+  if (actuator >= ACTUATOR_COUNT)
+    return false;
+  Actuator &a = actuators[actuator];
+  uint32_t nowMs = millis();
+  countRun(a, nowMs);
+  uint32_t runMs = a.on ? nowMs - a.runStartMs : 0;
+  counters->onTimeS = a.rec.onTimeS;
+  counters->starts = a.rec.starts;
+  counters->longestRunMs = runMs > a.rec.longestRunMs ? runMs : a.rec.longestRunMs;
+  counters->dutyTodayPermille = permille(a.rec.dayOnS, doseClockNow() % SECONDS_PER_DAY + 1);
+  counters->dutyYesterdayPermille = a.rec.yesterdayPermille;
+  return true;
+}
+
+void print(uint8_t actuator) {
+  ActuatorCounters c;
+  if (!get(actuator, &c))
+    return;
+  SerialPrint(PUMPS, "actuator=", NAMES[actuator], " onTimeS=", c.onTimeS, " starts=", c.starts,
+              " longestRunMs=", c.longestRunMs, " dutyTodayPermille=", c.dutyTodayPermille,
+              " dutyYesterdayPermille=", c.dutyYesterdayPermille);
+}
+
+} // namespace ActuatorStats
@@ -0,0 +1,71 @@
+/**
+ * ============================================================================
+ * ACTUATOR_STATS.H - Persistent Actuator Runtime and Wear Counters
+ * ============================================================================
+ *
+ * One set of counters per actuator: every relay of the RelayManager
+ * (dosing pumps, inlet, outlet) plus the light. The RelayManager and the
+ * light task report each switch; the counters measure the actual on-time
+ * with millis(), so they cover timed runs, level corrections, manual runs
+ * and cleaning alike.
+ *
+ * Counters: total on-time, starts, longest single run and the duty cycle of
+ * the current and the previous day (dose clock days, see dose_ledger.h).
+ * They are flushed to EEPROM in batches: every ACTUATOR_STATS_FLUSH_S, only
+ * the actuators whose counters changed, with a run in progress folded in so
+ * a reset loses at most one batch.
+ */
+
+#ifndef ACTUATOR_STATS_H
+#define ACTUATOR_STATS_H
+
+#include "relay_manager.h"
+#include <stdint.h>
+
+// Actuators 0..RELAY_COUNT-1 are the relays in RelayManager::relayIndex()
+// order; the light follows them
+constexpr uint8_t ACTUATOR_LIGHT = RELAY_COUNT;
+constexpr uint8_t ACTUATOR_COUNT = RELAY_COUNT + 1;
+
+struct ActuatorCounters {
+  uint32_t onTimeS;          // Total measured on-time
+  uint32_t starts;           // Off -> on switches
+  uint32_t longestRunMs;     // Longest single run
+  uint16_t dutyTodayPermille;
+  uint16_t dutyYesterdayPermille;
+};
+
+namespace ActuatorStats {
+
+/**
+ * Load the stored counters. Call after initDoseLedger() (day windows use
+ * the dose clock) and before the first task runs.
+ */
+void init();
+
+/**
+ * Report a switch of an actuator (repeated reports of the same state are
+ * ignored).
+ */
+void switched(uint8_t actuator, bool on);
+
+/**
+ * PERSIST task: write the changed counters once ACTUATOR_STATS_FLUSH_S have
+ * passed since the last batch.
+ */
+void flushDue();
+
+/**
+ * Counters including the run in progress.
+ * @return false for an invalid actuator
+ */
+bool get(uint8_t actuator, ActuatorCounters *counters);
+
+/**
+ * Print one actuator's counters (one line).
+ */
+void print(uint8_t actuator);
+
+} // namespace ActuatorStats
+
+#endif // ACTUATOR_STATS_H
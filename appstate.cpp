@@ -26,5 +26,5 @@ bool lightOverrideActive = false;
 
 // cleaning interval state
 uint16_t waterCleaningIntervalDays = 0; // days between cycles
-uint64_t lastCleaningTime = 0; // epoch seconds of last cycle
+uint64_t lastCleaningTime = 0; // dose clock at the last cycle
 }
@@ -66,8 +66,8 @@ extern bool lightOverrideActive;
 // Water cleaning interval in days; 0 disables automatic cleaning.
 extern uint16_t waterCleaningIntervalDays;
 
-// Timestamp (seconds) when the last cleaning cycle was performed. Used to
-// schedule the next automatic run.
+// Dose clock (dose_ledger.h) at the start of the last cleaning cycle. Used
+// to schedule the next automatic run.
 extern uint64_t lastCleaningTime;
 
 } // namespace AppState
@@ -0,0 +1,219 @@
+/**
+ * ============================================================================
+ * CONSOLE.CPP - Serial Maintenance Console
+ * ============================================================================
+ */
+
+#include "console.h"
+#include "actuator_stats.h"
+#include "debug.hpp"
+#include "dose_ledger.h"
+#include "dosing_planner.h"
+#include "i2c_bus.h"
+#include "latency.h"
+#include "pump_flow.h"
+#include "scheduler.h"
+#include "storage.h"
+#include "water.h"
+#include <Arduino.h>
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+constexpr uint8_t COMMAND_MAX_LEN = 24;
+
+char line[COMMAND_MAX_LEN + 1];
+uint8_t lineLen = 0;
+
+// Report rows still to print: latency probes, scheduler tasks, sampling,
+// I2C devices, pad calibration (dry, wet), inlet/outlet rates, actuators
+constexpr uint8_t REPORT_IDLE = 0xFF;
+constexpr int SERIAL_TX_IDLE_BYTES = 63; // HardwareSerial TX buffer (64) is empty
+uint8_t reportRow = REPORT_IDLE;
+
+#if LATENCY_PROFILING_ENABLED
+constexpr uint8_t LATENCY_ROWS = LATENCY_PROBE_COUNT;
+#else
+constexpr uint8_t LATENCY_ROWS = 0;
+#endif
+
+constexpr uint8_t SAMPLING_ROW = LATENCY_ROWS + TASK_COUNT;
+constexpr uint8_t CALIBRATION_ROW = SAMPLING_ROW + 1 + I2C_DEVICE_COUNT;
+constexpr uint8_t LET_RATE_ROW = CALIBRATION_ROW + 2;
+constexpr uint8_t ACTUATOR_ROW = LET_RATE_ROW + 1;
+constexpr uint8_t REPORT_ROWS = ACTUATOR_ROW + ACTUATOR_COUNT;
+
+// Ring position of the dose ledger dump (0 = oldest), paced like the report
+uint8_t ledgerRow = REPORT_IDLE;
+
+void printTaskRow(TaskId id) {
+  TaskStats s = Scheduler::getStats(id);
+  SerialPrint(SCHEDULER, "task=", Scheduler::taskName(id), " runs=", s.runCount,
+              " overruns=", s.overrunCount, " maxDurationMs=", s.maxDurationMs,
+              " maxLatenessMs=", s.maxLatenessMs);
+}
+
+void printSamplingRow() {
+  SamplingStats s = getSamplingStats();
+  SerialPrint(WATER, "sampling mode=", s.mode == SamplingMode::FAST ? "FAST" : "SLOW",
+              " framesPerMin=", s.framesPerMinute, " busPermille=", s.busPermille,
+              " modeChanges=", s.modeChanges);
+}
+
+// Prints one row of the "stats" report per call, once the previous row has
+// left the transmit buffer (a row longer than the buffer still blocks for
+// the remainder).
+void advanceReport() {
+  if (reportRow == REPORT_IDLE || Serial.availableForWrite() < SERIAL_TX_IDLE_BYTES)
+    return;
+#if LATENCY_PROFILING_ENABLED
+  if (reportRow < LATENCY_ROWS)
+    Latency::printStats(static_cast<LatencyProbe>(reportRow));
+#endif
+  if (reportRow >= LATENCY_ROWS && reportRow < SAMPLING_ROW)
+    printTaskRow(static_cast<TaskId>(reportRow - LATENCY_ROWS));
+  if (reportRow == SAMPLING_ROW)
+    printSamplingRow();
+  if (reportRow > SAMPLING_ROW && reportRow < CALIBRATION_ROW)
+    I2cBus::printStats(static_cast<I2cDevice>(reportRow - SAMPLING_ROW - 1));
+  if (reportRow >= CALIBRATION_ROW && reportRow < LET_RATE_ROW)
+    printSensorCalibration(reportRow == CALIBRATION_ROW ? CalibrationPoint::DRY
+                                                        : CalibrationPoint::WET);
+  if (reportRow == LET_RATE_ROW)
+    printLetRateModel();
+  if (reportRow >= ACTUATOR_ROW)
+    ActuatorStats::print(reportRow - ACTUATOR_ROW);
+  reportRow++;
+  if (reportRow >= REPORT_ROWS)
+    reportRow = REPORT_IDLE;
+}
+
+void advanceLedgerDump() {
+  if (ledgerRow == REPORT_IDLE || Serial.availableForWrite() < SERIAL_TX_IDLE_BYTES)
+    return;
+  if (!printNextDoseLedgerEntry(&ledgerRow))
+    ledgerRow = REPORT_IDLE;
+}
+
+// "<pump> [value]": 1-based dosing pump number, then an optional number.
+// @return false unless the pump exists and, if wanted, a value follows
+bool parsePumpArgs(const char* args, uint8_t* pumpIndex, uint16_t* value) {
+  char* end;
+  unsigned long pump = strtoul(args, &end, 10);
+  if (end == args || pump < 1 || pump > Hardware::DOSING_PUMP_COUNT)
+    return false;
+  *pumpIndex = static_cast<uint8_t>(pump - 1);
+  if (value == nullptr)
+    return *end == '\0';
+  const char* number = end;
+  unsigned long parsed = strtoul(number, &end, 10);
+  if (end == number || *end != '\0' || parsed > 0xFFFFUL)
+    return false;
+  *value = static_cast<uint16_t>(parsed);
+  return true;
+}
+
+void runFlowCommand(const char* args) {
+  uint8_t pump;
+  uint16_t volumeMl;
+  if (args[0] == '\0') {
+    printPumpFlow();
+  } else if (strncmp(args, " run ", 5) == 0 && parsePumpArgs(args + 5, &pump, nullptr)) {
+    if (!startFlowCalibration(pump))
+      SerialPrint(LOOP, "flow run not started (calibration or relay busy)");
+  } else if (strncmp(args, " ml ", 4) == 0 && parsePumpArgs(args + 4, &pump, &volumeMl)) {
+    setMeasuredFlowVolume(pump, volumeMl);
+  } else if (strcmp(args, " reset") == 0) {
+    resetPumpFlow();
+  } else {
+    SerialPrint(LOOP, "usage: flow | flow run <pump> | flow ml <pump> <ml> | flow reset");
+  }
+}
+
+// "<pump> HH:MM" or "<pump> off" -> dosing pump and anchor minute of day
+bool parseAnchorArgs(const char* args, uint8_t* pumpIndex, uint16_t* minuteOfDay) {
+  char* end;
+  unsigned long pump = strtoul(args, &end, 10);
+  if (end == args || *end != ' ' || pump < 1 || pump > Hardware::DOSING_PUMP_COUNT)
+    return false;
+  *pumpIndex = static_cast<uint8_t>(pump - 1);
+  const char* time = end + 1;
+  if (strcmp(time, "off") == 0) {
+    *minuteOfDay = DOSE_ANCHOR_NONE;
+    return true;
+  }
+  unsigned long hours = strtoul(time, &end, 10);
+  if (end == time || *end != ':' || hours > 23)
+    return false;
+  const char* minutes = end + 1;
+  unsigned long minute = strtoul(minutes, &end, 10);
+  if (end == minutes || *end != '\0' || minute > 59)
+    return false;
+  *minuteOfDay = static_cast<uint16_t>(hours * 60 + minute);
+  return true;
+}
+
+void runDoseCommand(const char* args) {
+  uint8_t pump;
+  uint16_t minuteOfDay;
+  if (args[0] == '\0') {
+    printDosingPlan();
+  } else if (strncmp(args, " at ", 4) == 0 && parseAnchorArgs(args + 4, &pump, &minuteOfDay)) {
+    setDoseAnchor(pump, minuteOfDay);
+  } else {
+    SerialPrint(LOOP, "usage: dose | dose at <pump> <HH:MM|off>");
+  }
+}
+
+void runCommand(const char* cmd) {
+  if (strcmp(cmd, "stats") == 0) {
+    if (LATENCY_ROWS == 0)
+      SerialPrint(LOOP, "latency profiling compiled out (LATENCY_PROFILING_ENABLED=0)");
+    reportRow = 0;
+  } else if (strcmp(cmd, "reset") == 0) {
+#if LATENCY_PROFILING_ENABLED
+    Latency::reset();
+#endif
+    I2cBus::reset();
+    SerialPrint(LOOP, "latency and I2C statistics cleared");
+  } else if (strcmp(cmd, "cal dry") == 0 || strcmp(cmd, "cal wet") == 0) {
+    startSensorCalibration(cmd[4] == 'd' ? CalibrationPoint::DRY : CalibrationPoint::WET);
+  } else if (strcmp(cmd, "cal end") == 0) {
+    endSensorCalibration();
+  } else if (strcmp(cmd, "cal reset") == 0) {
+    resetSensorCalibration();
+  } else if (strncmp(cmd, "flow", 4) == 0) {
+    runFlowCommand(cmd + 4);
+  } else if (strcmp(cmd, "ledger") == 0) {
+    if (doseLedgerSize() == 0)
+      SerialPrint(LOOP, "dose ledger empty");
+    ledgerRow = 0;
+  } else if (strncmp(cmd, "dose", 4) == 0) {
+    runDoseCommand(cmd + 4);
+  } else if (strcmp(cmd, "save") == 0) {
+    saveAppStateToConfiguration();
+  } else if (strcmp(cmd, "help") == 0) {
+    SerialPrint(LOOP, "commands: help, stats, reset, cal dry|wet|end|reset, flow [run|ml|reset], dose [at], ledger, save");
+  } else if (cmd[0] != '\0') {
+    SerialPrint(LOOP, "unknown command '", cmd, "' (try help)");
+  }
+}
+
+} // namespace
+
+void handleConsole() {
+  // Only what already arrived: never wait for the rest of a line
+  while (Serial.available() > 0) {
+    char c = static_cast<char>(Serial.read());
+    if (c == '\r' || c == '\n') {
+      line[lineLen] = '\0';
+      runCommand(line);
+      lineLen = 0;
+    } else if (lineLen < COMMAND_MAX_LEN) {
+      line[lineLen++] = c;
+    }
+  }
+  advanceReport();
+  advanceLedgerDump();
+}
@@ -0,0 +1,45 @@
+/**
+ * ============================================================================
+ * CONSOLE.H - Serial Maintenance Console
+ * ============================================================================
+ *
+ * Line-based commands typed into the serial monitor (newline terminated).
+ * The CONSOLE task collects at most the bytes already received and never
+ * waits for more; long reports are printed one line per tick so a dump at
+ * 9600 baud does not stall the other tasks.
+ *
+ * Commands:
+ *   help       list commands
+ *   stats      latency table (see latency.h), scheduler overrun counters,
+ *              sensor sampling rate / bus occupancy, per-device I2C
+ *              transaction latency (see i2c_bus.h), pad calibration, the
+ *              learned inlet/outlet rates and the on-time, starts, longest
+ *              run and duty cycle of every actuator (see actuator_stats.h)
+ *   reset      clear the latency and I2C statistics
+ *   cal dry    capture the dry pad references (sensor out of the water)
+ *   cal wet    capture the wet pad references (sensor fully submerged)
+ *   cal end    close the calibration session, resume level control
+ *   cal reset  back to nominal pad references, stored profile erased
+ *   flow       flow rate of every dosing pump (see pump_flow.h)
+ *   flow run N run dosing pump N (1-based) for FLOW_CALIBRATION_RUN_MS
+ *   flow ml N V store V ml, measured from pump N's last run, as its rate
+ *   flow reset back to the nominal flow rate, stored rates erased
+ *   dose       interval, anchor and next due time of every dosing pump
+ *              (see dosing_planner.h)
+ *   dose at N HH:MM  dose pump N at that wall-clock time of day
+ *   dose at N off    dose pump N on its interval alone
+ *   ledger     every dose ledger entry, oldest first (see dose_ledger.h)
+ *   save       commit the configuration now; nothing is written when no
+ *              field changed (see storage.h)
+ */
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+/**
+ * CONSOLE task body: reads pending serial input and advances a report that
+ * is being printed.
+ */
+void handleConsole();
+
+#endif // CONSOLE_H
@@ -24,7 +24,9 @@ enum Location {
   KEYPAD_INPUT = 12,
   MONITOR = 13,
   LIGHTS = 14,
-  FACTORY = 15
+  FACTORY = 15,
+  SCHEDULER = 16,
+  I2C = 17
 };
 
 enum Errors {
@@ -54,6 +56,8 @@ inline void printLocationTag(Location tag) {
     case MONITOR: Serial.print(F("MONITOR")); break;
     case LIGHTS:  Serial.print(F("LIGHTS")); break;
     case FACTORY: Serial.print(F("FACTORY")); break;
+    case SCHEDULER: Serial.print(F("SCHED")); break;
+    case I2C:     Serial.print(F("I2C")); break;
     default:      Serial.print(F("UNKNOWN")); break;
   }
 }
@@ -3,12 +3,115 @@
  * DISPLAY.CPP - LCD Display Implementation
  * ============================================================================
  *
- * Initializes and manages the 16x2 LCD display connected via I2C.
+ * Initializes and manages the 16x2 LCD display connected via I2C, through a
+ * shadow framebuffer flushed in slices by the UI task.
  */
 
 #include "display.h"
+#include "i2c_bus.h"
+#include "latency.h"
 
-// Create global LCD object with specified I2C address and dimensions
-LiquidCrystal_I2C lcd(Hardware::LCD_I2C_ADDRESS, Hardware::LCD_WIDTH, Hardware::LCD_HEIGHT);
+namespace {
+
+// The panel itself; only LcdShadow talks to it
+LiquidCrystal_I2C panel(Hardware::LCD_I2C_ADDRESS, Hardware::LCD_WIDTH, Hardware::LCD_HEIGHT);
+
+constexpr uint32_t ALL_CELLS_UNKNOWN = 0xFFFFFFFFUL;
+
+} // namespace
+
+// Global LCD object
+LcdShadow lcd;
 // Timer for display dimming/timeout functionality
 uint32_t dimTimer = 0u;
+
+void LcdShadow::init() {
+  uint32_t startUs = micros();
+  panel.init();
+  I2cBus::begin(); // init() re-runs Wire.begin(), which resets the clock
+  I2cBus::record(I2cDevice::LCD, micros() - startUs);
+  memset(wanted, ' ', sizeof(wanted));
+  unknownMask = ALL_CELLS_UNKNOWN;
+  cursorCol = cursorRow = 0;
+  scrubRow = 0;
+  lastScrubMs = millis();
+}
+
+void LcdShadow::backlight() {
+  uint32_t startUs = micros();
+  panel.backlight();
+  I2cBus::record(I2cDevice::LCD, micros() - startUs);
+}
+
+void LcdShadow::clear() {
+  memset(wanted, ' ', sizeof(wanted));
+  home();
+}
+
+void LcdShadow::home() { setCursor(0, 0); }
+
+void LcdShadow::setCursor(uint8_t col, uint8_t row) {
+  cursorCol = col;
+  cursorRow = row;
+}
+
+// Redefining a slot changes every cell showing it at once, exactly as on
+// the bare panel, so there is nothing to defer.
+void LcdShadow::createChar(uint8_t slot, uint8_t charmap[]) {
+  uint32_t startUs = micros();
+  panel.createChar(slot, charmap);
+  I2cBus::record(I2cDevice::LCD, micros() - startUs);
+}
+
+// Like the panel's DDRAM, the cursor keeps advancing past the last visible
+// column; those characters are simply not shown.
+size_t LcdShadow::write(uint8_t value) {
+  if (cursorCol < Hardware::LCD_WIDTH && cursorRow < Hardware::LCD_HEIGHT)
+    wanted[cursorRow * Hardware::LCD_WIDTH + cursorCol] = value;
+  cursorCol++;
+  return 1;
+}
+
+void LcdShadow::flush() {
+  LATENCY_SPAN(LatencyProbe::LCD_FLUSH);
+  scrub();
+  flushCells(Hardware::LCD_FLUSH_BUDGET_US, true);
+}
+
+void LcdShadow::flushAll() { flushCells(0xFFFFFFFFUL, false); }
+
+// Marks one row as unknown every LCD_SCRUB_INTERVAL_MS so it is rewritten.
+void LcdShadow::scrub() {
+  uint32_t now = millis();
+  if (now - lastScrubMs < Hardware::LCD_SCRUB_INTERVAL_MS)
+    return;
+  lastScrubMs = now;
+  uint32_t rowMask = (1UL << Hardware::LCD_WIDTH) - 1;
+  unknownMask |= rowMask << (scrubRow * Hardware::LCD_WIDTH);
+  scrubRow = (scrubRow + 1) % Hardware::LCD_HEIGHT;
+}
+
+// Writes changed cells in order; a run of adjacent cells needs a single
+// setCursor. Each cell counts as one LCD transaction.
+void LcdShadow::flushCells(uint32_t budgetUs, bool yieldToSensor) {
+  if (I2cBus::isBackingOff(I2cDevice::LCD)) return;
+  uint32_t startUs = micros();
+  bool cursorInPlace = false;
+  for (uint8_t cell = 0; cell < CELLS; cell++) {
+    uint32_t bit = 1UL << cell;
+    bool changed = (unknownMask & bit) || wanted[cell] != shown[cell];
+    if (!changed || cell % Hardware::LCD_WIDTH == 0) cursorInPlace = false;
+    if (!changed) continue;
+    if (micros() - startUs >= budgetUs || (yieldToSensor && I2cBus::sensorPending())) return;
+    uint32_t cellStartUs = micros();
+    if (!cursorInPlace) panel.setCursor(cell % Hardware::LCD_WIDTH, cell / Hardware::LCD_WIDTH);
+    panel.write(wanted[cell]);
+    if (!I2cBus::record(I2cDevice::LCD, micros() - cellStartUs)) {
+      unknownMask = ALL_CELLS_UNKNOWN; // Panel state lost; redraw after the backoff
+      return;
+    }
+    shown[cell] = wanted[cell];
+    unknownMask &= ~bit;
+    cursorInPlace = true;
+  }
+}
@@ -22,8 +22,52 @@
 
 #include "hardware.h"
 
+// Drop-in front end for the LCD: screens draw into a RAM framebuffer with
+// the usual LiquidCrystal_I2C calls (setCursor/print/write/clear) and
+// nothing reaches the bus until flush(). The flush sends only cells that
+// differ from what the panel shows, so clearing and redrawing an unchanged
+// screen costs no I2C traffic, and it runs in slices that yield to sensor
+// transfers (see i2c_bus.h). createChar() and backlight() go straight to the
+// panel.
+class LcdShadow : public Print {
+public:
+  void init();
+  void backlight();
+  void clear();
+  void home();
+  void setCursor(uint8_t col, uint8_t row);
+  void createChar(uint8_t slot, uint8_t charmap[]);
+  size_t write(uint8_t value) override;
+
+  /**
+   * UI task: send changed cells for up to LCD_FLUSH_BUDGET_US, stopping
+   * early when a sensor transfer is due.
+   */
+  void flush();
+
+  /**
+   * Send every changed cell now (splash animation, before a reset).
+   */
+  void flushAll();
+
+private:
+  static constexpr uint8_t CELLS = Hardware::LCD_WIDTH * Hardware::LCD_HEIGHT;
+  static_assert(CELLS <= 32, "unknownMask holds one bit per cell");
+
+  void flushCells(uint32_t budgetUs, bool yieldToSensor);
+  void scrub();
+
+  uint8_t wanted[CELLS]; // Framebuffer the screens draw into
+  uint8_t shown[CELLS];  // What the panel displays
+  uint32_t unknownMask;  // Cells whose panel content is unknown
+  uint8_t cursorCol;
+  uint8_t cursorRow;
+  uint8_t scrubRow;
+  uint32_t lastScrubMs;
+};
+
 // Global LCD object for display operations
-extern LiquidCrystal_I2C lcd;
+extern LcdShadow lcd;
 // Timer for display dimming functionality
 extern uint32_t dimTimer;
 
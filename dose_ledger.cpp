@@ -0,0 +1,207 @@
+/**
+ * ============================================================================
+ * DOSE_LEDGER.CPP - Persistent Dose Ledger and Dose Clock
+ * ============================================================================
+ */
+
+#include "dose_ledger.h"
+#include "appstate.h"
+#include "debug.hpp"
+#include "hardware.h"
+#include "pumps.h"
+#include "screens.h"
+#include "storage.h"
+#include <Arduino.h>
+#include <EEPROM.h>
+
+namespace {
+
+struct DoseLedgerEntry {
+  uint32_t at;       // Dose clock seconds
+  uint16_t volumeMl;
+  uint8_t meta;      // Pump index << 4 | DoseOutcome
+  uint8_t crc;       // CRC-8 of the bytes above
+};
+
+constexpr uint8_t ENTRY_SIZE = sizeof(DoseLedgerEntry);
+constexpr uint8_t ENTRY_BODY = ENTRY_SIZE - 1;
+constexpr uint8_t SLOTS = (EepromMap::DOSE_LEDGER_END - EepromMap::DOSE_LEDGER_ADDR) / ENTRY_SIZE;
+constexpr uint32_t BLANK_TIME = 0xFFFFFFFFUL; // Erased EEPROM
+
+static_assert(ENTRY_SIZE == 8, "ledger entries are 8 bytes");
+
+// Dose clock checkpoint ring: a marker, then [u32 clock][CRC-8] per slot.
+// The area used to hold configuration journal slots, so slots are only
+// trusted behind the marker; its first byte never matches a journal header.
+constexpr uint32_t CLOCK_RING_MARKER = 0x4B434C44UL; // "DLCK"
+constexpr uint16_t CLOCK_SLOTS_ADDR = EepromMap::DOSE_CLOCK_RING_ADDR + sizeof(CLOCK_RING_MARKER);
+constexpr uint8_t CLOCK_SLOT_SIZE = sizeof(uint32_t) + 1;
+constexpr uint8_t CLOCK_SLOTS = (EepromMap::DOSE_CLOCK_RING_END - CLOCK_SLOTS_ADDR) / CLOCK_SLOT_SIZE;
+
+uint32_t bootTime = 1;    // Dose clock at uptime 0
+uint8_t head = 0;         // Slot of the next entry
+uint8_t used = 0;         // Valid entries, up to SLOTS
+uint32_t lastCheckpoint = 0;
+uint8_t clockHead = 0;    // Checkpoint slot of the next write
+
+uint16_t slotAddress(uint8_t slot) { return EepromMap::DOSE_LEDGER_ADDR + slot * ENTRY_SIZE; }
+
+bool readEntry(uint8_t slot, DoseLedgerEntry *entry) {
+  EEPROM.get(slotAddress(slot), *entry);
+  return entry->at != BLANK_TIME && entry->crc == crc8(0, entry, ENTRY_BODY);
+}
+
+// Newest entry = latest timestamp; entries with equal timestamps were
+// appended back to back, so the last of that run is the newest.
+uint8_t newestSlot(uint32_t newestAt, uint8_t candidate) {
+  DoseLedgerEntry entry;
+  for (uint8_t step = 0; step < SLOTS; step++) {
+    uint8_t next = (candidate + 1) % SLOTS;
+    if (!readEntry(next, &entry) || entry.at != newestAt)
+      break;
+    candidate = next;
+  }
+  return candidate;
+}
+
+// One pass: newest timestamp, valid entries and each pump's last dose.
+void scanLedger(uint32_t *newestAt, uint32_t lastDose[]) {
+  DoseLedgerEntry entry;
+  uint8_t newest = SLOTS;
+  for (uint8_t slot = 0; slot < SLOTS; slot++) {
+    if (!readEntry(slot, &entry))
+      continue;
+    used++;
+    if (newest == SLOTS || entry.at > *newestAt) {
+      *newestAt = entry.at;
+      newest = slot;
+    }
+    uint8_t pump = entry.meta >> 4;
+    if (pump < Hardware::DOSING_PUMP_COUNT &&
+        (entry.meta & 0x0F) == static_cast<uint8_t>(DoseOutcome::STARTED) &&
+        entry.at > lastDose[pump])
+      lastDose[pump] = entry.at;
+  }
+  if (newest != SLOTS)
+    head = (newestSlot(*newestAt, newest) + 1) % SLOTS;
+}
+
+uint16_t clockSlotAddress(uint8_t slot) { return CLOCK_SLOTS_ADDR + slot * CLOCK_SLOT_SIZE; }
+
+bool readClockSlot(uint8_t slot, uint32_t *at) {
+  uint16_t address = clockSlotAddress(slot);
+  EEPROM.get(address, *at);
+  return *at != BLANK_TIME && EEPROM.read(address + sizeof(*at)) == crc8(0, at, sizeof(*at));
+}
+
+// Blanks every slot, then writes the marker: a torn format is redone.
+void formatClockRing() {
+  for (uint16_t address = CLOCK_SLOTS_ADDR; address < EepromMap::DOSE_CLOCK_RING_END; address++)
+    EEPROM.update(address, 0xFF);
+  EEPROM.put(EepromMap::DOSE_CLOCK_RING_ADDR, CLOCK_RING_MARKER);
+  SerialPrint(PUMPS, "Dose clock checkpoint ring formatted");
+}
+
+// The clock only moves forward, so the newest checkpoint is the largest.
+uint32_t scanClockRing() {
+  uint32_t newest = 0;
+  uint32_t at;
+  EEPROM.get(EepromMap::DOSE_CLOCK_RING_ADDR, at);
+  if (at != CLOCK_RING_MARKER)
+    formatClockRing(); // Leftover bytes are never read as checkpoints
+  for (uint8_t slot = 0; slot < CLOCK_SLOTS; slot++) {
+    if (readClockSlot(slot, &at) && at >= newest) {
+      newest = at;
+      clockHead = (slot + 1) % CLOCK_SLOTS;
+    }
+  }
+  // Checkpoint of firmware before the ring, superseded by the first slot
+  uint32_t legacy = 0;
+  loadRecord(EepromMap::DOSE_CLOCK_ADDR, &legacy, sizeof(legacy));
+  return legacy > newest ? legacy : newest;
+}
+
+// CRC invalidated first: a torn write can never pass the check.
+void writeClockSlot(uint8_t slot, uint32_t at) {
+  uint16_t address = clockSlotAddress(slot);
+  uint8_t crc = crc8(0, &at, sizeof(at));
+  EEPROM.update(address + sizeof(at), static_cast<uint8_t>(~crc));
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&at);
+  for (uint8_t i = 0; i < sizeof(at); i++)
+    EEPROM.update(address + i, bytes[i]);
+  EEPROM.update(address + sizeof(at), crc);
+}
+
+const __FlashStringHelper *outcomeName(uint8_t outcome) {
+  switch (static_cast<DoseOutcome>(outcome)) {
+  case DoseOutcome::STARTED:   return F("STARTED");
+  case DoseOutcome::COMPLETED: return F("COMPLETED");
+  case DoseOutcome::ABORTED:   return F("ABORTED");
+  default:                     return F("?");
+  }
+}
+
+} // namespace
+
+void initDoseLedger() {
+  uint32_t newestAt = 0;
+  uint32_t lastDose[Hardware::DOSING_PUMP_COUNT] = {};
+  scanLedger(&newestAt, lastDose);
+  uint32_t checkpoint = scanClockRing();
+  bootTime = (newestAt > checkpoint ? newestAt : checkpoint) + 1;
+  lastCheckpoint = bootTime;
+  for (uint8_t i = 0; i < Hardware::DOSING_PUMP_COUNT; i++) {
+    DosingConfig cfg = AppState::pumps[i].getConfig();
+    cfg.lastTime = lastDose[i];
+    AppState::pumps[i].setConfig(cfg);
+  }
+  SerialPrint(PUMPS, "Dose ledger entries=", used, " doseClock=", bootTime);
+}
+
+uint32_t doseClockNow() { return bootTime + static_cast<uint32_t>(seconds()); }
+
+uint32_t doseClockBootTime() { return bootTime; }
+
+void recordDose(uint8_t pumpIndex, uint16_t volumeMl, DoseOutcome outcome) {
+  DoseLedgerEntry entry;
+  entry.at = doseClockNow();
+  entry.volumeMl = volumeMl;
+  entry.meta = static_cast<uint8_t>((pumpIndex << 4) | static_cast<uint8_t>(outcome));
+  entry.crc = crc8(0, &entry, ENTRY_BODY);
+  // CRC invalidated first: a torn write can never pass the check
+  uint16_t address = slotAddress(head);
+  EEPROM.update(address + ENTRY_BODY, static_cast<uint8_t>(~entry.crc));
+  const uint8_t *bytes = reinterpret_cast<const uint8_t *>(&entry);
+  for (uint8_t i = 0; i < ENTRY_SIZE; i++)
+    EEPROM.update(address + i, bytes[i]);
+  head = (head + 1) % SLOTS;
+  if (used < SLOTS)
+    used++;
+}
+
+void checkpointDoseClock(uint32_t now) {
+  if (now - lastCheckpoint < Hardware::DOSE_CLOCK_CHECKPOINT_S)
+    return;
+  lastCheckpoint = now;
+  writeClockSlot(clockHead, now);
+  clockHead = (clockHead + 1) % CLOCK_SLOTS;
+}
+
+uint8_t doseLedgerSize() { return used; }
+
+// Ring order from the slot after the newest entry; torn or blank slots are
+// skipped, so they never shift the entries around them.
+bool printNextDoseLedgerEntry(uint8_t *position) {
+  DoseLedgerEntry entry;
+  for (; *position < SLOTS; (*position)++) {
+    uint8_t slot = (head + *position) % SLOTS;
+    if (!readEntry(slot, &entry))
+      continue;
+    (*position)++;
+    SerialPrint(PUMPS, "ledger slot=", slot, " at=", entry.at, " agoS=", doseClockNow() - entry.at,
+                " pump=", (entry.meta >> 4) + 1, " ml=", entry.volumeMl, " ",
+                outcomeName(entry.meta & 0x0F));
+    return true;
+  }
+  return false;
+}
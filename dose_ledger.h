@@ -0,0 +1,88 @@
+/**
+ * ============================================================================
+ * DOSE_LEDGER.H - Persistent Dose Ledger and Dose Clock
+ * ============================================================================
+ *
+ * Every dose is appended to a ring of 8-byte entries in EEPROM
+ * (DOSE_LEDGER_ADDR..DOSE_LEDGER_END): when it starts, with the requested
+ * volume, and when it ends, with the delivered volume. Entries carry a
+ * CRC-8, so a write torn by a reset is skipped and never mistaken for the
+ * newest entry.
+ *
+ * Timestamps come from the dose clock: seconds that keep counting across
+ * reboots. The board has no real-time clock, so at boot the dose clock
+ * resumes from the newest ledger entry or the newest checkpoint, whichever
+ * is later; power-off time is not counted. A dose is therefore delayed by
+ * an outage but never repeated because of one.
+ *
+ * Checkpoints are written every DOSE_CLOCK_CHECKPOINT_S (60 s) to a ring of
+ * CRC-checked slots (DOSE_CLOCK_RING_ADDR..END, behind a marker; a ring
+ * without it is blanked first), so a reset loses at most that much uptime.
+ * A board that resets more often than that still advances its clock by one
+ * second per boot (enough to never repeat a ledger timestamp), but no
+ * faster: doses, cleaning cycles and duty-cycle days stall until it runs
+ * for longer than one checkpoint period.
+ *
+ * The cleaning schedule (water_cleaning.cpp) uses the same clock.
+ *
+ * Boot scans the ring once to find its head and each pump's last started
+ * dose, which becomes DosingConfig::lastTime. The console prints the
+ * ledger oldest first (`ledger`).
+ */
+
+#ifndef DOSE_LEDGER_H
+#define DOSE_LEDGER_H
+
+#include <stdint.h>
+
+enum class DoseOutcome : uint8_t {
+  STARTED,   // Relay run accepted; volume = requested ml
+  COMPLETED, // Ran for its full time; volume = delivered ml
+  ABORTED    // Stopped early; volume = delivered ml
+};
+
+/**
+ * Scan the ledger: restore the dose clock and each dosing pump's last dose
+ * time. Call after the configuration has been applied to AppState and
+ * before initDosingPlanner().
+ */
+void initDoseLedger();
+
+/**
+ * @return Dose clock now, in seconds (never 0)
+ */
+uint32_t doseClockNow();
+
+/**
+ * @return Dose clock at boot; uptime 0 corresponds to this value
+ */
+uint32_t doseClockBootTime();
+
+/**
+ * Append one entry, stamped with the dose clock.
+ * Side effects: up to 8 EEPROM writes (~3.3 ms each).
+ */
+void recordDose(uint8_t pumpIndex, uint16_t volumeMl, DoseOutcome outcome);
+
+/**
+ * Store the dose clock in the next checkpoint slot once
+ * DOSE_CLOCK_CHECKPOINT_S have passed since the last checkpoint; called from
+ * the DOSING task.
+ * Side effects: up to 6 EEPROM writes (~3.3 ms each).
+ */
+void checkpointDoseClock(uint32_t now);
+
+/**
+ * @return Valid entries in the ledger
+ */
+uint8_t doseLedgerSize();
+
+/**
+ * Print the next valid ledger entry, oldest first.
+ * @param position Ring position to continue from, 0 for the oldest; advanced
+ *                 past the printed entry
+ * @return false once no entry is left (nothing printed)
+ */
+bool printNextDoseLedgerEntry(uint8_t *position);
+
+#endif // DOSE_LEDGER_H
@@ -0,0 +1,204 @@
+/**
+ * ============================================================================
+ * DOSING_PLANNER.CPP - Dosing Event Queue
+ * ============================================================================
+ */
+
+#include "dosing_planner.h"
+#include "appstate.h"
+#include "debug.hpp"
+#include "dose_ledger.h"
+#include "hardware.h"
+#include "pumps.h"
+#include "storage.h"
+#include <Arduino.h>
+
+namespace {
+
+constexpr uint8_t DOSING_PUMPS = Hardware::DOSING_PUMP_COUNT;
+constexpr uint32_t SECONDS_PER_DAY = 86400UL;
+constexpr uint32_t DUE_NEVER = 0xFFFFFFFFUL; // Saturated: interval beyond uptime range
+constexpr uint8_t NOT_QUEUED = 0xFF;
+
+struct DoseAnchors {
+  uint16_t minuteOfDay[DOSING_PUMPS]; // DOSE_ANCHOR_NONE = interval only
+};
+
+DoseAnchors anchors;
+
+// Binary min-heap on dueAt; slotOf[pump] is the pump's heap position
+uint32_t heapDue[DOSING_PUMPS];
+uint8_t heapPump[DOSING_PUMPS];
+uint8_t slotOf[DOSING_PUMPS];
+uint8_t heapSize = 0;
+
+void clearAnchors() {
+  for (uint8_t i = 0; i < DOSING_PUMPS; i++)
+    anchors.minuteOfDay[i] = DOSE_ANCHOR_NONE;
+}
+
+void swapSlots(uint8_t a, uint8_t b) {
+  uint32_t due = heapDue[a];
+  heapDue[a] = heapDue[b];
+  heapDue[b] = due;
+  uint8_t pump = heapPump[a];
+  heapPump[a] = heapPump[b];
+  heapPump[b] = pump;
+  slotOf[heapPump[a]] = a;
+  slotOf[heapPump[b]] = b;
+}
+
+void siftUp(uint8_t slot) {
+  while (slot > 0) {
+    uint8_t parent = (slot - 1) / 2;
+    if (heapDue[parent] <= heapDue[slot])
+      return;
+    swapSlots(parent, slot);
+    slot = parent;
+  }
+}
+
+void siftDown(uint8_t slot) {
+  for (;;) {
+    uint8_t smallest = slot;
+    uint8_t left = 2 * slot + 1;
+    uint8_t right = left + 1;
+    if (left < heapSize && heapDue[left] < heapDue[smallest])
+      smallest = left;
+    if (right < heapSize && heapDue[right] < heapDue[smallest])
+      smallest = right;
+    if (smallest == slot)
+      return;
+    swapSlots(slot, smallest);
+    slot = smallest;
+  }
+}
+
+void removeFromHeap(uint8_t pump) {
+  uint8_t slot = slotOf[pump];
+  if (slot == NOT_QUEUED)
+    return;
+  slotOf[pump] = NOT_QUEUED;
+  heapSize--;
+  if (slot == heapSize)
+    return;
+  uint8_t moved = heapPump[heapSize]; // Last entry fills the hole
+  heapDue[slot] = heapDue[heapSize];
+  heapPump[slot] = moved;
+  slotOf[moved] = slot;
+  siftUp(slot);
+  siftDown(slotOf[moved]);
+}
+
+void insertIntoHeap(uint8_t pump, uint32_t dueAt) {
+  uint8_t slot = heapSize++;
+  heapDue[slot] = dueAt;
+  heapPump[slot] = pump;
+  slotOf[pump] = slot;
+  siftUp(slot);
+}
+
+uint32_t saturate(uint64_t seconds) {
+  return seconds >= DUE_NEVER ? DUE_NEVER : static_cast<uint32_t>(seconds);
+}
+
+// Dose clock of the first anchor slot at least half a day short of
+// `interval` days after the last dose or, without a recorded dose, after
+// `now`. The slack keeps the anchor time when a dose ran a little late,
+// while a clock that lost time across a reboot cannot repeat a dose.
+// Wall clock = timeOffset + uptime = dose clock + offset (mod one day).
+uint32_t anchoredDueAt(const DosingConfig &cfg, uint16_t minuteOfDay, uint32_t now) {
+  uint32_t offset = (static_cast<uint32_t>(AppState::timeOffset) % SECONDS_PER_DAY +
+                     SECONDS_PER_DAY - doseClockBootTime() % SECONDS_PER_DAY) % SECONDS_PER_DAY;
+  uint64_t earliest = cfg.lastTime != 0
+                          ? cfg.lastTime + cfg.interval * SECONDS_PER_DAY - SECONDS_PER_DAY / 2
+                          : now + 1ULL;
+  earliest += offset;
+  uint64_t slot = earliest - earliest % SECONDS_PER_DAY + minuteOfDay * 60UL;
+  if (slot < earliest)
+    slot += SECONDS_PER_DAY;
+  return saturate(slot - offset); // slot >= earliest > offset
+}
+
+// lastTime 0 = no dose in the ledger: the first dose is one interval after boot
+uint32_t computeDueAt(uint8_t pump, const DosingConfig &cfg) {
+  uint16_t anchor = anchors.minuteOfDay[pump];
+  if (anchor != DOSE_ANCHOR_NONE)
+    return anchoredDueAt(cfg, anchor, doseClockNow());
+  uint64_t lastDose = cfg.lastTime != 0 ? cfg.lastTime : doseClockBootTime();
+  return saturate(lastDose + cfg.interval * SECONDS_PER_DAY);
+}
+
+} // namespace
+
+void initDosingPlanner() {
+  for (uint8_t i = 0; i < DOSING_PUMPS; i++)
+    slotOf[i] = NOT_QUEUED;
+  if (!loadRecord(EepromMap::DOSE_ANCHOR_ADDR, &anchors, sizeof(anchors)))
+    clearAnchors();
+  replanAllDoses();
+}
+
+void replanDose(uint8_t pumpIndex) {
+  if (pumpIndex >= DOSING_PUMPS)
+    return;
+  removeFromHeap(pumpIndex);
+  const Pump &pump = AppState::pumps[pumpIndex];
+  DosingConfig cfg = pump.getConfig();
+  if (pump.getRole() != PumpRole::DOSING || cfg.interval == 0 || cfg.amount == 0)
+    return;
+  insertIntoHeap(pumpIndex, computeDueAt(pumpIndex, cfg));
+}
+
+void replanAllDoses() {
+  for (uint8_t i = 0; i < DOSING_PUMPS; i++)
+    replanDose(i);
+  SerialPrint(PUMPS, "Dosing plan rebuilt, pumps scheduled=", heapSize);
+}
+
+bool nextDueDose(uint32_t now, uint8_t *pumpIndex) {
+  if (heapSize == 0 || heapDue[0] > now)
+    return false;
+  *pumpIndex = heapPump[0];
+  return true;
+}
+
+void deferDose(uint8_t pumpIndex, uint32_t dueAt) {
+  if (pumpIndex >= DOSING_PUMPS || slotOf[pumpIndex] == NOT_QUEUED)
+    return;
+  removeFromHeap(pumpIndex);
+  insertIntoHeap(pumpIndex, dueAt);
+}
+
+bool setDoseAnchor(uint8_t pumpIndex, uint16_t minuteOfDay) {
+  if (pumpIndex >= DOSING_PUMPS ||
+      (minuteOfDay >= MINUTES_PER_DAY && minuteOfDay != DOSE_ANCHOR_NONE))
+    return false;
+  anchors.minuteOfDay[pumpIndex] = minuteOfDay;
+  storeRecord(EepromMap::DOSE_ANCHOR_ADDR, &anchors, sizeof(anchors));
+  replanDose(pumpIndex);
+  SerialPrint(PUMPS, "Dose anchor stored pump=", pumpIndex + 1, " minuteOfDay=", minuteOfDay);
+  return true;
+}
+
+void resetDosingPlanner() {
+  clearAnchors();
+  eraseRecord(EepromMap::DOSE_ANCHOR_ADDR, sizeof(anchors));
+  replanAllDoses();
+}
+
+void printDosingPlan() {
+  uint32_t now = doseClockNow();
+  for (uint8_t i = 0; i < DOSING_PUMPS; i++) {
+    DosingConfig cfg = AppState::pumps[i].getConfig();
+    uint16_t anchor = anchors.minuteOfDay[i];
+    int16_t anchorMin = anchor == DOSE_ANCHOR_NONE ? -1 : static_cast<int16_t>(anchor);
+    if (slotOf[i] == NOT_QUEUED) {
+      SerialPrint(PUMPS, "dose pump=", i + 1, " anchorMin=", anchorMin, " not scheduled");
+      continue;
+    }
+    SerialPrint(PUMPS, "dose pump=", i + 1, " ml=", cfg.amount,
+                " intervalDays=", static_cast<uint32_t>(cfg.interval), " anchorMin=", anchorMin,
+                " dueInS=", static_cast<int32_t>(heapDue[slotOf[i]] - now));
+  }
+}
@@ -0,0 +1,79 @@
+/**
+ * ============================================================================
+ * DOSING_PLANNER.H - Dosing Event Queue
+ * ============================================================================
+ *
+ * Keeps the next due time of every scheduled dosing pump, in dose clock
+ * seconds (see dose_ledger.h), in a min-heap. Due times are computed only
+ * when a pump's configuration, its anchor or the clock changes, so the
+ * DOSING task costs one comparison against the head of the heap while
+ * nothing is due.
+ *
+ * A pump without an anchor doses every `interval` days after its last dose
+ * (the first one `interval` days after boot when the ledger holds none). An
+ * anchored pump doses at a fixed wall-clock time of day: the first
+ * occurrence at least `interval` days minus half a day after its last dose,
+ * or the next occurrence without a recorded dose. Anchors are stored in
+ * EEPROM.
+ */
+
+#ifndef DOSING_PLANNER_H
+#define DOSING_PLANNER_H
+
+#include <stdint.h>
+
+constexpr uint16_t DOSE_ANCHOR_NONE = 0xFFFF; // Interval after the last dose
+constexpr uint16_t MINUTES_PER_DAY = 1440;
+
+/**
+ * Load the stored anchors and plan every dosing pump. Call after
+ * initDoseLedger() has restored the last dose times.
+ */
+void initDosingPlanner();
+
+/**
+ * Recompute one pump's due time; call after its DosingConfig changed
+ * (amount, interval or lastTime). Pumps with no amount or interval leave
+ * the queue.
+ */
+void replanDose(uint8_t pumpIndex);
+
+/**
+ * Recompute every due time; call after the wall clock was set.
+ */
+void replanAllDoses();
+
+/**
+ * Head of the queue, if it is due.
+ * @param now Dose clock (doseClockNow())
+ * @param pumpIndex Receives the dosing pump to run
+ * @return false while the earliest due time is still ahead (or no pump is
+ *         scheduled)
+ */
+bool nextDueDose(uint32_t now, uint8_t *pumpIndex);
+
+/**
+ * Move a queued pump's due time, e.g. to retry a dose whose relay was busy.
+ */
+void deferDose(uint8_t pumpIndex, uint32_t dueAt);
+
+/**
+ * Anchor a pump's doses to a wall-clock time of day and store the anchors.
+ * @param minuteOfDay 0..MINUTES_PER_DAY-1, or DOSE_ANCHOR_NONE to dose on
+ *                    the interval alone
+ * @return false for an invalid pump or minute
+ */
+bool setDoseAnchor(uint8_t pumpIndex, uint16_t minuteOfDay);
+
+/**
+ * Clear every anchor and erase the stored ones.
+ */
+void resetDosingPlanner();
+
+/**
+ * Print interval, anchor and time until the next dose of every dosing pump
+ * (one line per pump).
+ */
+void printDosingPlan();
+
+#endif // DOSING_PLANNER_H
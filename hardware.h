@@ -41,9 +41,25 @@ constexpr uint8_t KEYPAD_COL_PINS[] = { 31, 33, 35, 37 };
 // LCD I2C address
 constexpr uint8_t LCD_I2C_ADDRESS = 0x27;
 
-// Water sensor I2C addresses
+// Water sensor I2C addresses and pads per chip (low chip at the bottom)
 constexpr uint8_t WATER_SENSOR_HIGH_ADDR = 0x78;
 constexpr uint8_t WATER_SENSOR_LOW_ADDR = 0x77;
+constexpr uint8_t WATER_SENSOR_LOW_PADS = 8;
+constexpr uint8_t WATER_SENSOR_HIGH_PADS = 12;
+constexpr uint8_t WATER_SENSOR_CHIP_COUNT = 2;
+
+// Shared bus clock for the LCD and both sensor pads (applied by I2cBus::begin)
+constexpr uint32_t I2C_CLOCK_HZ = 100000UL;
+// TWI pins (Mega 2560), driven by hand during bus recovery
+constexpr uint8_t I2C_SDA_PIN = 20;
+constexpr uint8_t I2C_SCL_PIN = 21;
+// A transfer stalled this long aborts and resets the TWI (a 12-byte read
+// takes ~1.2 ms at 100 kHz)
+constexpr uint32_t I2C_TIMEOUT_US = 5000UL;
+// Retry delay after a failed device transfer, doubling per consecutive
+// failure up to the maximum
+constexpr uint16_t I2C_BACKOFF_MIN_MS = 250;
+constexpr uint16_t I2C_BACKOFF_MAX_MS = 8000;
 
 // ============================================================================
 // Hardware Constants
@@ -55,6 +71,11 @@ constexpr uint32_t SERIAL_BAUD = 9600;
 // LCD dimensions
 constexpr uint8_t LCD_WIDTH = 16;
 constexpr uint8_t LCD_HEIGHT = 2;
+// Longest LCD flush slice per UI tick (one cell costs ~1 ms at 100 kHz)
+constexpr uint16_t LCD_FLUSH_BUDGET_US = 4000;
+// One LCD row is rewritten from the framebuffer this often, repairing
+// cells corrupted by bus glitches
+constexpr uint16_t LCD_SCRUB_INTERVAL_MS = 1000;
 
 // UI timing
 
@@ -67,26 +88,142 @@ constexpr uint16_t UI_DELAY_MEDIUM_MS = 1000;
 // 2 sec time value
 constexpr uint16_t UI_DELAY_LONG_MS = 2000;
 
-// Pump flow rate (ml/second)
+// Nominal dosing pump flow rate (ml/second) until a pump is calibrated
 constexpr uint8_t PUMP_FLOW_RATE_ML_PER_SEC = 2;
+// Flow calibration (pump_flow.h): length of the measured run, and the
+// accepted rates in 1/256 ml/s (0.1 - 50 ml/s)
+constexpr uint16_t FLOW_CALIBRATION_RUN_MS = 30000;
+constexpr uint16_t FLOW_CALIBRATION_MIN_RUN_MS = 5000; // Shorter (aborted) runs are discarded
+constexpr uint16_t FLOW_RATE_MIN_Q8 = 26;
+constexpr uint16_t FLOW_RATE_MAX_Q8 = 50U * 256U;
+// Dose clock (dose_ledger.h) checkpoint period; uptime since the last
+// checkpoint is lost when the board resets. Short, so that frequent resets
+// (e.g. brownouts) cannot hold the clock still; the ring of checkpoint slots
+// keeps the wear per cell at one write per ring turn (~51 min)
+constexpr uint16_t DOSE_CLOCK_CHECKPOINT_S = 60;
+// Actuator counters (actuator_stats.h) are written to EEPROM in batches this
+// far apart; a reset loses at most one batch
+constexpr uint16_t ACTUATOR_STATS_FLUSH_S = 3600;
 
 // Safety limits
 constexpr uint16_t MAX_PUMP_RUN_TIME_MS = 30000;   // 30 seconds maximum pump runtime
+// Cool-down between the pulses of a dose longer than MAX_PUMP_RUN_TIME_MS
+constexpr uint16_t DOSE_PULSE_GAP_MS = 10000;
 constexpr uint16_t SENSOR_READ_TIMEOUT_MS = 1000;  // 1 second timeout for sensor reads
+// A cached sensor frame older than this counts as lost (SENSOR_TIMEOUT);
+// must exceed the frame interval at the slow sampling rate
+constexpr uint16_t SENSOR_FRAME_MAX_AGE_MS = 2500;
+// Longest continuous fill/drain before the level controller latches FAULT
+constexpr uint32_t LEVEL_CORRECTION_TIMEOUT_MS = 10UL * 60UL * 1000UL;  // 10 minutes
+// Longest pump on-time per cleaning phase (drain or fill) before it aborts
+constexpr uint32_t CLEANING_PHASE_TIMEOUT_MS = 20UL * 60UL * 1000UL;  // 20 minutes
+// Cleaning progress is checkpointed to EEPROM at least this often
+constexpr uint32_t CLEANING_CHECKPOINT_INTERVAL_MS = 60UL * 1000UL;
 
 // Water level sensing constants
 constexpr uint8_t NO_TOUCH_VALUE = 0xFE;
 constexpr uint8_t TOUCH_THRESHOLD = 100;
+constexpr uint8_t SENSOR_PAD_COUNT = WATER_SENSOR_LOW_PADS + WATER_SENSOR_HIGH_PADS;  // 5 % each
+// Nominal pad readings in air / submerged until the pads are calibrated;
+// used to interpolate the level within the pad at the waterline
+constexpr uint8_t PAD_DRY_REFERENCE = 10;
+constexpr uint8_t PAD_WET_REFERENCE = 200;
+// Calibration: frames averaged per capture, smallest accepted wet-dry span
+constexpr uint8_t CALIBRATION_FRAMES = 8;
+constexpr uint8_t CALIBRATION_MIN_SPAN = 40;
+// A calibration session holds level control until closed or this long
+// after its last capture
+constexpr uint32_t CALIBRATION_SESSION_TIMEOUT_MS = 10UL * 60UL * 1000UL;
+// Drift tracking: baselines of pads well away from the waterline move one
+// count per interval towards the reading; changes are saved at most this often
+constexpr uint32_t CALIBRATION_DRIFT_INTERVAL_MS = 60UL * 1000UL;
+constexpr uint32_t CALIBRATION_SAVE_INTERVAL_MS = 6UL * 60UL * 60UL * 1000UL;
+
+// Level filter: majority vote over the last N touch masks, then an EMA with
+// weight 1/2^shift per frame (~1 s time constant at 4 frames/s)
+constexpr uint8_t LEVEL_VOTE_WINDOW = 5;
+constexpr uint8_t LEVEL_EMA_SHIFT = 2;
+// Span over which levelRatePerMinute() measures the trend
+constexpr uint16_t LEVEL_TREND_WINDOW_MS = 15000;
+// Trend (0.1 %/min) up to which an idle tank counts as stable
+constexpr uint8_t LEVEL_STABLE_RATE = 5;
+// Fast sampling continues this long after the water stopped moving
+constexpr uint16_t SENSOR_FAST_HOLD_MS = 10000;
+// Averaging window of the sampling instrumentation
+constexpr uint16_t SAMPLING_STATS_WINDOW_MS = 10000;
 
 // Hysteresis margin (percentage)
 constexpr uint8_t HYSTERESIS_MARGIN_PERCENT = 5;
 
+// Learned inlet/outlet rate model (water_rate.cpp). Levels count as settled
+// this long after the last inlet/outlet run (filter lag); each correction
+// pulse aims this far past its threshold, in 1/256 %.
+constexpr uint16_t LET_SETTLE_MS = 4000;
+constexpr uint16_t LET_PULSE_MIN_MS = 500;
+constexpr uint8_t LET_TARGET_MARGIN_Q8 = 128;
+// Runs that moved the level less than this (1/256 %) are not learned from;
+// a new sample moves the estimate by 1/2^shift of the difference
+constexpr uint8_t LET_LEARN_MIN_DELTA_Q8 = 128;
+constexpr uint8_t LET_RATE_GAIN_SHIFT = 2;
+
+// ============================================================================
+// Task Scheduling (period / relative deadline, ms)
+// ============================================================================
+
+// Pump engine tick: bounds relay shutoff latency
+constexpr uint16_t TASK_PUMPS_PERIOD_MS = 5;
+constexpr uint16_t TASK_PUMPS_DEADLINE_MS = 10;
+
+// Sensor sampling: one touch pad per tick, a full frame every 250 ms while
+// water moves, every 1 s when the tank is idle (see updateSensorSampling)
+constexpr uint16_t TASK_SENSOR_PERIOD_MS = 125;
+constexpr uint16_t TASK_SENSOR_SLOW_PERIOD_MS = 500;
+constexpr uint16_t TASK_SENSOR_DEADLINE_MS = 100;
+
+// Level control: hysteresis check and automatic cleaning schedule
+constexpr uint16_t TASK_LEVEL_PERIOD_MS = 250;
+constexpr uint16_t TASK_LEVEL_DEADLINE_MS = 100;
+
+// Dosing schedule: interval granularity is days, 1 s is plenty
+constexpr uint16_t TASK_DOSING_PERIOD_MS = 1000;
+constexpr uint16_t TASK_DOSING_DEADLINE_MS = 500;
+
+// Light schedule: second resolution on/off times
+constexpr uint16_t TASK_LIGHTS_PERIOD_MS = 1000;
+constexpr uint16_t TASK_LIGHTS_DEADLINE_MS = 500;
+
+// Keypad scan and LCD refresh
+constexpr uint16_t TASK_UI_PERIOD_MS = 50;
+constexpr uint16_t TASK_UI_DEADLINE_MS = 100;
+
+// Idle/status screen redraw interval (only changed cells reach the bus)
+constexpr uint16_t UI_IDLE_REDRAW_MS = 1000;
+
+// Deferred EEPROM commits
+constexpr uint16_t TASK_PERSIST_PERIOD_MS = 1000;
+constexpr uint16_t TASK_PERSIST_DEADLINE_MS = 1000;
+
+// Configuration commits: written once edits have been quiet this long, but
+// never later than the max delay after the first uncommitted edit
+constexpr uint16_t CONFIG_SAVE_QUIET_MS = 5000;
+constexpr uint32_t CONFIG_SAVE_MAX_DELAY_MS = 60000UL;
+
+// Serial maintenance console (one report line per tick)
+constexpr uint16_t TASK_CONSOLE_PERIOD_MS = 200;
+constexpr uint16_t TASK_CONSOLE_DEADLINE_MS = 200;
+
 // ============================================================================
 // Hardware Configuration
 // ============================================================================
 
 constexpr uint8_t PUMP_COUNT = 5;
 constexpr uint8_t DOSING_PUMP_COUNT = 3;
+
+// Relay load budget (see relay_manager.h): pumps are only switched on while
+// the sum of their nominal supply currents stays within the budget.
+constexpr uint16_t DOSING_PUMP_LOAD_MA = 300;   // Peristaltic dosing pump
+constexpr uint16_t LET_PUMP_LOAD_MA = 800;      // Inlet or outlet pump
+constexpr uint16_t RELAY_LOAD_BUDGET_MA = 1500; // Pump supply rating
 constexpr uint8_t KEYPAD_ROWS = 4;
 constexpr uint8_t KEYPAD_COLS = 4;
 
@@ -0,0 +1,177 @@
+/**
+ * ============================================================================
+ * I2C_BUS.CPP - Shared I2C Bus Arbiter
+ * ============================================================================
+ */
+
+#include "i2c_bus.h"
+#include "debug.hpp"
+#include "hardware.h"
+#include "scheduler.h"
+#include <Arduino.h>
+#include <Wire.h>
+
+namespace {
+
+I2cDeviceStats stats[I2C_DEVICE_COUNT];
+uint32_t retryAtMs[I2C_DEVICE_COUNT]; // Backoff end for failing devices
+constexpr uint8_t BUS_RECOVERY_CLOCKS = 9; // Enough for any slave to finish a byte
+constexpr uint8_t HALF_CLOCK_US = 5;       // 100 kHz
+
+uint8_t deviceIndex(I2cDevice device) { return static_cast<uint8_t>(device); }
+
+const __FlashStringHelper* deviceName(I2cDevice device) {
+  switch (device) {
+  case I2cDevice::LCD:         return F("lcd");
+  case I2cDevice::SENSOR_LOW:  return F("sensorLow");
+  case I2cDevice::SENSOR_HIGH: return F("sensorHigh");
+  default:                     return F("UNKNOWN");
+  }
+}
+
+// Open-drain emulation: drive low, or release to the pull-up.
+void driveLine(uint8_t pin, bool low) {
+  if (low) {
+    digitalWrite(pin, LOW);
+    pinMode(pin, OUTPUT);
+  } else {
+    pinMode(pin, INPUT_PULLUP);
+  }
+  delayMicroseconds(HALF_CLOCK_US);
+}
+
+// Clocks SCL until a slave stuck mid-byte releases SDA, issues a STOP and
+// re-initialises the TWI (~100 us).
+void recoverBus(I2cDevice device) {
+  Wire.end();
+  driveLine(Hardware::I2C_SDA_PIN, false);
+  uint8_t clocks = 0;
+  while (clocks < BUS_RECOVERY_CLOCKS && digitalRead(Hardware::I2C_SDA_PIN) == LOW) {
+    driveLine(Hardware::I2C_SCL_PIN, true);
+    driveLine(Hardware::I2C_SCL_PIN, false);
+    clocks++;
+  }
+  driveLine(Hardware::I2C_SDA_PIN, true); // STOP: SDA rises while SCL is high
+  driveLine(Hardware::I2C_SDA_PIN, false);
+  bool released = digitalRead(Hardware::I2C_SDA_PIN) == HIGH;
+  I2cBus::begin();
+  I2cDeviceStats& s = stats[deviceIndex(device)];
+  if (s.recoveries != 0xFFFF)
+    s.recoveries++;
+  SerialPrint(I2C, "Bus recovery after device=", deviceName(device), " clocks=", clocks,
+              " sdaReleased=", released);
+}
+
+// Timeout flag or SDA held low while idle: the bus, not the device, is stuck.
+bool busStuck() {
+  if (Wire.getWireTimeoutFlag()) {
+    Wire.clearWireTimeoutFlag();
+    return true;
+  }
+  return digitalRead(Hardware::I2C_SDA_PIN) == LOW;
+}
+
+void noteResult(I2cDevice device, bool ok) {
+  I2cDeviceStats& s = stats[deviceIndex(device)];
+  if (ok) {
+    if (s.failStreak != 0)
+      SerialPrint(I2C, "Device recovered device=", deviceName(device), " failStreak=", s.failStreak);
+    s.failStreak = 0;
+    return;
+  }
+  if (s.errors != 0xFFFF)
+    s.errors++;
+  if (s.failStreak != 0xFF)
+    s.failStreak++;
+  uint8_t shift = s.failStreak > 6 ? 5 : s.failStreak - 1;
+  uint32_t backoffMs = static_cast<uint32_t>(Hardware::I2C_BACKOFF_MIN_MS) << shift;
+  if (backoffMs > Hardware::I2C_BACKOFF_MAX_MS)
+    backoffMs = Hardware::I2C_BACKOFF_MAX_MS;
+  retryAtMs[deviceIndex(device)] = millis() + backoffMs;
+  if (s.failStreak == 1 || backoffMs < Hardware::I2C_BACKOFF_MAX_MS)
+    SerialPrint(I2C, "WARN device=", deviceName(device), " failed failStreak=", s.failStreak,
+                " backoffMs=", backoffMs);
+  if (busStuck())
+    recoverBus(device);
+}
+
+void addTime(I2cDevice device, uint32_t us) {
+  I2cDeviceStats& s = stats[deviceIndex(device)];
+  s.transactions++;
+  s.totalUs += us;
+  if (us > s.maxUs)
+    s.maxUs = us > 0xFFFF ? 0xFFFF : static_cast<uint16_t>(us);
+}
+
+} // namespace
+
+namespace I2cBus {
+
+void begin() {
+  Wire.begin();
+  Wire.setClock(Hardware::I2C_CLOCK_HZ);
+  Wire.setWireTimeout(Hardware::I2C_TIMEOUT_US, true);
+}
+
+uint8_t read(I2cDevice device, uint8_t address, uint8_t *buf, uint8_t len) {
+  if (device >= I2cDevice::COUNT)
+    return 0;
+  if (isBackingOff(device)) {
+    I2cDeviceStats& s = stats[deviceIndex(device)];
+    if (s.skipped != 0xFFFF)
+      s.skipped++;
+    return 0;
+  }
+  uint32_t startUs = micros();
+  uint8_t received = Wire.requestFrom(address, len);
+  if (received == len) {
+    for (uint8_t i = 0; i < len; i++) buf[i] = Wire.read();
+  } else {
+    while (Wire.available() > 0) Wire.read();
+  }
+  addTime(device, micros() - startUs);
+  noteResult(device, received == len);
+  return received;
+}
+
+bool record(I2cDevice device, uint32_t us) {
+  if (device >= I2cDevice::COUNT)
+    return false;
+  addTime(device, us);
+  bool ok = !Wire.getWireTimeoutFlag();
+  noteResult(device, ok); // On failure busStuck() still sees the flag
+  return ok;
+}
+
+bool isBackingOff(I2cDevice device) {
+  if (device >= I2cDevice::COUNT || stats[deviceIndex(device)].failStreak == 0)
+    return false;
+  return static_cast<int32_t>(millis() - retryAtMs[deviceIndex(device)]) < 0;
+}
+
+bool sensorPending() { return Scheduler::isDue(TaskId::SENSOR); }
+
+I2cDeviceStats getStats(I2cDevice device) {
+  if (device >= I2cDevice::COUNT)
+    return I2cDeviceStats{};
+  return stats[deviceIndex(device)];
+}
+
+void printStats(I2cDevice device) {
+  I2cDeviceStats s = getStats(device);
+  uint32_t meanUs = s.transactions == 0 ? 0 : static_cast<uint32_t>(s.totalUs / s.transactions);
+  SerialPrint(LOOP, "i2c device=", deviceName(device), " n=", s.transactions, " errors=", s.errors,
+              " skipped=", s.skipped, " recoveries=", s.recoveries, " failStreak=", s.failStreak,
+              " meanUs=", meanUs, " maxUs=", s.maxUs, " clockHz=", Hardware::I2C_CLOCK_HZ);
+}
+
+// Health state (failStreak, backoff) survives; only the counters restart.
+void reset() {
+  for (uint8_t i = 0; i < I2C_DEVICE_COUNT; i++) {
+    uint8_t failStreak = stats[i].failStreak;
+    stats[i] = I2cDeviceStats{};
+    stats[i].failStreak = failStreak;
+  }
+}
+
+} // namespace I2cBus
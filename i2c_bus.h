@@ -0,0 +1,103 @@
+/**
+ * ============================================================================
+ * I2C_BUS.H - Shared I2C Bus Arbiter
+ * ============================================================================
+ *
+ * The LCD (0x27) and both touch sensor pads (0x77/0x78) share one Wire bus.
+ * Every transfer goes through here so the bus clock is set in one place and
+ * each device's transaction latency is measured.
+ *
+ * Bus health: Wire aborts a transfer stalled for I2C_TIMEOUT_US. After a
+ * failed transfer, a timeout or SDA held low triggers the standard
+ * recovery (SCL clocked until the slave releases SDA, a STOP, TWI re-init).
+ * A device that fails is not addressed again until its backoff expires
+ * (I2C_BACKOFF_MIN_MS doubling up to I2C_BACKOFF_MAX_MS); reads in between
+ * fail at once without touching the bus, so a dead sensor costs
+ * microseconds per poll.
+ *
+ * Only one transfer is ever in flight in the cooperative loop, so ordering
+ * is by priority class rather than a literal queue:
+ *   - sensor transfers run as soon as the SENSOR task is due;
+ *   - LCD traffic is background work drained from the display's shadow
+ *     framebuffer (display.h) in budgeted slices that stop as soon as a
+ *     sensor transfer is due (sensorPending()), so a sensor read waits for
+ *     at most one LCD cell, never for a full-screen redraw.
+ */
+
+#ifndef I2C_BUS_H
+#define I2C_BUS_H
+
+#include <Arduino.h>
+#include <stdint.h>
+
+enum class I2cDevice : uint8_t {
+  LCD,
+  SENSOR_LOW,  // Water sensor low pad (8 bytes)
+  SENSOR_HIGH, // Water sensor high pad (12 bytes)
+  COUNT
+};
+
+constexpr uint8_t I2C_DEVICE_COUNT = static_cast<uint8_t>(I2cDevice::COUNT);
+
+struct I2cDeviceStats {
+  uint32_t transactions;
+  uint16_t errors;     // Short or missing replies, timeouts
+  uint16_t skipped;    // Reads refused while backing off
+  uint16_t recoveries; // Bus recoveries run after this device's transfers
+  uint16_t maxUs;      // Longest transaction (saturates)
+  uint64_t totalUs;    // Sum of transaction times, for the mean
+  uint8_t failStreak;  // Consecutive failed transfers (0 = healthy)
+};
+
+namespace I2cBus {
+
+/**
+ * Start Wire and apply Hardware::I2C_CLOCK_HZ. Also called after anything
+ * that re-runs Wire.begin() (which resets the clock to 100 kHz).
+ */
+void begin();
+
+/**
+ * Read `len` bytes from a device and record the transaction.
+ * @return Bytes received; a short read is drained and counted as an error.
+ *         0 without a transfer while the device is backing off.
+ */
+uint8_t read(I2cDevice device, uint8_t address, uint8_t *buf, uint8_t len);
+
+/**
+ * Record a transaction performed by a device driver (the LCD library).
+ * A Wire timeout since the last check counts as a failure and recovers
+ * the bus.
+ * @return false if the transaction failed
+ */
+bool record(I2cDevice device, uint32_t us);
+
+/**
+ * @return true while a failed device waits for its backoff to expire
+ */
+bool isBackingOff(I2cDevice device);
+
+/**
+ * @return true when a sensor transfer is due: background LCD traffic must
+ *         yield the bus
+ */
+bool sensorPending();
+
+/**
+ * @return Copy of one device's transaction statistics
+ */
+I2cDeviceStats getStats(I2cDevice device);
+
+/**
+ * Print one device's statistics as a single line.
+ */
+void printStats(I2cDevice device);
+
+/**
+ * Zero every device's statistics.
+ */
+void reset();
+
+} // namespace I2cBus
+
+#endif // I2C_BUS_H
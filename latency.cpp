@@ -0,0 +1,110 @@
+/**
+ * ============================================================================
+ * LATENCY.CPP - Loop and Task Latency Instrumentation
+ * ============================================================================
+ */
+
+#include "latency.h"
+
+#if LATENCY_PROFILING_ENABLED
+
+#include "debug.hpp"
+#include "hardware.h"
+
+namespace {
+
+LatencyStats stats[LATENCY_PROBE_COUNT];
+
+// Overrun thresholds. Tasks get theirs from Scheduler::addTask(); the loop
+// budget is the pump tick deadline, since a longer iteration delays a
+// relay shutoff.
+uint32_t budgetUs[LATENCY_PROBE_COUNT] = {
+    Hardware::TASK_PUMPS_DEADLINE_MS * 1000UL,
+};
+
+uint8_t bucketOf(uint32_t us) {
+  uint8_t bucket = 0;
+  for (us >>= 4; us != 0 && bucket < LATENCY_BUCKETS - 1; us >>= 1)
+    bucket++;
+  return bucket;
+}
+
+// Keeps the histogram's shape once a bucket is full instead of clipping it.
+void countBucket(LatencyStats& s, uint8_t bucket) {
+  if (s.histogram[bucket] == 0xFFFF) {
+    for (uint8_t i = 0; i < LATENCY_BUCKETS; i++)
+      s.histogram[i] >>= 1;
+  }
+  s.histogram[bucket]++;
+}
+
+uint8_t probeIndex(LatencyProbe probe) { return static_cast<uint8_t>(probe); }
+
+} // namespace
+
+namespace Latency {
+
+void record(LatencyProbe probe, uint32_t us) {
+  if (probe >= LatencyProbe::COUNT)
+    return;
+  LatencyStats& s = stats[probeIndex(probe)];
+  if (s.count == 0 || us < s.minUs)
+    s.minUs = us;
+  if (us > s.maxUs)
+    s.maxUs = us;
+  s.count++;
+  s.totalUs += us;
+  uint32_t budget = budgetUs[probeIndex(probe)];
+  if (budget != 0 && us > budget && s.overruns != 0xFFFF)
+    s.overruns++;
+  countBucket(s, bucketOf(us));
+}
+
+void setBudget(LatencyProbe probe, uint32_t us) {
+  if (probe < LatencyProbe::COUNT)
+    budgetUs[probeIndex(probe)] = us;
+}
+
+LatencyStats getStats(LatencyProbe probe) {
+  if (probe >= LatencyProbe::COUNT)
+    return LatencyStats{};
+  return stats[probeIndex(probe)];
+}
+
+const __FlashStringHelper* probeName(LatencyProbe probe) {
+  if (probe >= LatencyProbe::TASK_FIRST && probe < LatencyProbe::CHECK_WATER_LEVEL)
+    return Scheduler::taskName(
+        static_cast<TaskId>(probeIndex(probe) - probeIndex(LatencyProbe::TASK_FIRST)));
+  switch (probe) {
+  case LatencyProbe::LOOP:              return F("loop");
+  case LatencyProbe::CHECK_WATER_LEVEL: return F("checkWaterLevel");
+  case LatencyProbe::LCD_PRINT:         return F("lcdPrintWithGlyphs");
+  case LatencyProbe::LCD_FLUSH:         return F("lcdFlush");
+  case LatencyProbe::CONFIG_SAVE:       return F("saveAppStateToConfiguration");
+  default:                              return F("UNKNOWN");
+  }
+}
+
+void printStats(LatencyProbe probe) {
+  LatencyStats s = getStats(probe);
+  uint32_t meanUs = s.count == 0 ? 0 : static_cast<uint32_t>(s.totalUs / s.count);
+  SerialPrint(LOOP, "latency probe=", probeName(probe), " n=", s.count, " minUs=", s.minUs,
+              " meanUs=", meanUs, " maxUs=", s.maxUs, " overruns=", s.overruns,
+              " budgetUs=", budgetUs[probeIndex(probe)]);
+#if DEBUG_SERIAL_ENABLED // Same gate as SerialPrint
+  Serial.print(F("  hist<16us*2^i="));
+  for (uint8_t i = 0; i < LATENCY_BUCKETS; i++) {
+    Serial.print(s.histogram[i]);
+    Serial.print(i + 1 < LATENCY_BUCKETS ? ',' : '\n');
+  }
+#endif
+}
+
+void reset() {
+  for (uint8_t i = 0; i < LATENCY_PROBE_COUNT; i++)
+    stats[i] = LatencyStats{};
+}
+
+} // namespace Latency
+
+#endif // LATENCY_PROFILING_ENABLED
@@ -0,0 +1,118 @@
+/**
+ * ============================================================================
+ * LATENCY.H - Loop and Task Latency Instrumentation
+ * ============================================================================
+ *
+ * Records micros() spans around loop(), every scheduler task and a few
+ * known-slow handlers (level step, LCD text output and flush, configuration
+ * save).
+ * Each probe keeps count, min/max/mean, a log2 histogram and the number of
+ * spans that exceeded its budget, all in fixed SRAM. The console module
+ * dumps the table over Serial on request ("stats").
+ *
+ * Set LATENCY_PROFILING_ENABLED to 0 to compile every probe out.
+ */
+
+#ifndef LATENCY_H
+#define LATENCY_H
+
+#include "scheduler.h"
+#include <Arduino.h>
+#include <stdint.h>
+
+#ifndef LATENCY_PROFILING_ENABLED
+#define LATENCY_PROFILING_ENABLED 1
+#endif
+
+// One probe per measured span. Task probes follow TaskId order.
+enum class LatencyProbe : uint8_t {
+  LOOP,
+  TASK_FIRST,
+  CHECK_WATER_LEVEL = TASK_FIRST + TASK_COUNT, // checkWaterLevel()
+  LCD_PRINT,                                   // lcdPrintWithGlyphs()
+  LCD_FLUSH,                                   // LcdShadow::flush()
+  CONFIG_SAVE,                                 // saveAppStateToConfiguration()
+  COUNT
+};
+
+constexpr uint8_t LATENCY_PROBE_COUNT = static_cast<uint8_t>(LatencyProbe::COUNT);
+
+// Bucket 0 holds spans < 16 us, bucket i spans in [2^(i+3), 2^(i+4)) us and
+// the last bucket everything from ~262 ms up.
+constexpr uint8_t LATENCY_BUCKETS = 16;
+
+inline LatencyProbe taskProbe(TaskId id) {
+  return static_cast<LatencyProbe>(static_cast<uint8_t>(LatencyProbe::TASK_FIRST) +
+                                   static_cast<uint8_t>(id));
+}
+
+struct LatencyStats {
+  uint32_t count;      // Recorded spans
+  uint32_t minUs;
+  uint32_t maxUs;
+  uint64_t totalUs;    // Sum of all spans, for the mean
+  uint16_t overruns;   // Spans longer than the probe's budget
+  uint16_t histogram[LATENCY_BUCKETS]; // Halved together when one saturates
+};
+
+#if LATENCY_PROFILING_ENABLED
+
+namespace Latency {
+
+/**
+ * Add one measured span to a probe.
+ * @param us Span length in microseconds
+ */
+void record(LatencyProbe probe, uint32_t us);
+
+/**
+ * Set the span length above which a probe counts an overrun.
+ * @param budgetUs Microseconds, 0 = never
+ */
+void setBudget(LatencyProbe probe, uint32_t budgetUs);
+
+/**
+ * @return Copy of a probe's statistics
+ */
+LatencyStats getStats(LatencyProbe probe);
+
+/**
+ * Printable probe name stored in flash.
+ */
+const __FlashStringHelper* probeName(LatencyProbe probe);
+
+/**
+ * Print one probe as a single [LOOP] line. Callers spread a full dump over
+ * several ticks: at 9600 baud one line costs ~150 ms of Serial time.
+ */
+void printStats(LatencyProbe probe);
+
+/**
+ * Zero every probe's statistics (budgets are kept).
+ */
+void reset();
+
+} // namespace Latency
+
+// Measures the enclosing scope into a probe.
+class LatencySpan {
+public:
+  explicit LatencySpan(LatencyProbe p) : probe(p), startUs(micros()) {}
+  ~LatencySpan() { Latency::record(probe, micros() - startUs); }
+
+private:
+  LatencyProbe probe;
+  uint32_t startUs;
+};
+
+#define LATENCY_SPAN(probe) LatencySpan latencySpan_(probe)
+
+#else
+
+#define LATENCY_SPAN(probe) \
+  do {                      \
+  } while (0)
+
+#endif // LATENCY_PROFILING_ENABLED
+
+#endif // LATENCY_H
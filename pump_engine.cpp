@@ -0,0 +1,149 @@
+/**
+ * ============================================================================
+ * PUMP_ENGINE.CPP - Non-blocking Pump Actuation Engine
+ * ============================================================================
+ */
+
+#include "pump_engine.h"
+#include "debug.hpp"
+#include "hardware.h"
+#include "water.h"
+#include <Arduino.h>
+
+// Shared pump runtime state (also read by water_control.cpp)
+WaterPumpState pumpState;
+
+namespace {
+
+// Latest run of one relay (slot index = RelayManager::relayIndex())
+struct PumpRun {
+  PumpRunHandle handle;
+  PumpRunStatus status;
+  uint16_t durationMs;
+  uint32_t startMs;       // millis() when the relay came on
+  PumpRunCallback onDone;
+};
+
+PumpRun runs[RELAY_COUNT];
+PumpRunHandle nextHandle = 1;
+
+PumpRunHandle issueHandle() {
+  PumpRunHandle h = nextHandle++;
+  if (nextHandle == PUMP_RUN_NONE)
+    nextHandle = 1;
+  return h;
+}
+
+bool isLive(const PumpRun& run) {
+  return run.status == PumpRunStatus::QUEUED || run.status == PumpRunStatus::RUNNING;
+}
+
+uint8_t slotPin(uint8_t slot) {
+  if (slot < Hardware::DOSING_PUMP_COUNT)
+    return Hardware::DOSING_PUMP_PINS[slot];
+  return slot == Hardware::DOSING_PUMP_COUNT ? Hardware::INLET_PUMP_PIN
+                                             : Hardware::OUTLET_PUMP_PIN;
+}
+
+// Switches the relay of a live run off and publishes the outcome.
+// Postcondition: the slot is no longer live.
+void finishRun(uint8_t slot, PumpRunStatus status) {
+  PumpRun& run = runs[slot];
+  uint8_t pin = slotPin(slot);
+  uint32_t ranMs = run.status == PumpRunStatus::RUNNING ? millis() - run.startMs : 0;
+  RelayManager::release(pin);
+  run.status = status;
+  PumpRunCallback cb = run.onDone;
+  run.onDone = nullptr;
+
+  SerialPrint(PUMPS, "Pump run finished handle=", run.handle, " pin=", pin, " ranMs=", ranMs,
+              status == PumpRunStatus::ABORTED ? " status=ABORTED" : " status=COMPLETED");
+  if (cb != nullptr)
+    cb(run.handle, status, ranMs);
+}
+
+void markRunning(uint8_t slot) {
+  PumpRun& run = runs[slot];
+  run.status = PumpRunStatus::RUNNING;
+  run.startMs = millis();
+  SerialPrint(PUMPS, "Pump run started handle=", run.handle, " pin=", slotPin(slot),
+              " durationMs=", run.durationMs);
+}
+
+int8_t findRun(PumpRunHandle handle) {
+  if (handle == PUMP_RUN_NONE)
+    return -1;
+  for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+    if (runs[i].handle == handle)
+      return i;
+  }
+  return -1;
+}
+
+} // namespace
+
+PumpRunHandle startPumpRun(uint8_t pumpPin, uint16_t durationMs, PumpRunCallback onDone,
+                           RelayPriority priority) {
+  uint8_t slot = RelayManager::relayIndex(pumpPin);
+  if (durationMs == 0 || slot == RELAY_NONE)
+    return PUMP_RUN_NONE;
+  if (isLive(runs[slot])) {
+    SerialPrint(PUMPS, "WARN pump run rejected pin=", pumpPin, " reason=relay busy");
+    return PUMP_RUN_NONE;
+  }
+  if (durationMs > Hardware::MAX_PUMP_RUN_TIME_MS) {
+    SerialPrint(PUMPS, "WARN pump run clamped pin=", pumpPin, " requestedMs=", durationMs,
+                " maxMs=", Hardware::MAX_PUMP_RUN_TIME_MS);
+    durationMs = Hardware::MAX_PUMP_RUN_TIME_MS;
+  }
+
+  PumpRun& run = runs[slot];
+  run = {issueHandle(), PumpRunStatus::QUEUED, durationMs, 0, onDone};
+  if (RelayManager::request(pumpPin, priority))
+    markRunning(slot);
+  else
+    SerialPrint(PUMPS, "Pump run queued handle=", run.handle, " pin=", pumpPin,
+                " loadMa=", RelayManager::committedLoadMa());
+  return run.handle;
+}
+
+void updatePumpRuns() {
+  uint32_t now = millis();
+  for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+    if (runs[i].status == PumpRunStatus::RUNNING && now - runs[i].startMs >= runs[i].durationMs)
+      finishRun(i, PumpRunStatus::COMPLETED);
+  }
+  RelayManager::update();
+  for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+    if (runs[i].status == PumpRunStatus::QUEUED && RelayManager::isOn(slotPin(i)))
+      markRunning(i);
+  }
+}
+
+bool stopPumpRun(PumpRunHandle handle) {
+  int8_t slot = findRun(handle);
+  if (slot < 0 || !isLive(runs[slot]))
+    return false;
+  finishRun(slot, PumpRunStatus::ABORTED);
+  return true;
+}
+
+void abortPumpRuns() {
+  for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+    if (isLive(runs[i]))
+      finishRun(i, PumpRunStatus::ABORTED);
+  }
+}
+
+PumpRunStatus getPumpRunStatus(PumpRunHandle handle) {
+  int8_t slot = findRun(handle);
+  return slot < 0 ? PumpRunStatus::UNKNOWN : runs[slot].status;
+}
+
+bool isPumpRunActive() {
+  for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+    if (isLive(runs[i]))
+      return true;
+  }
+  return false;
+}
@@ -0,0 +1,87 @@
+/**
+ * ============================================================================
+ * PUMP_ENGINE.H - Non-blocking Pump Actuation Engine
+ * ============================================================================
+ *
+ * Starts timed pump runs and stops them from a periodic tick instead of
+ * delay(). Every run is identified by a handle; callers either poll the
+ * handle's status or register a completion callback.
+ *
+ * Each relay carries at most one run at a time; runs on different relays
+ * overlap. The relay itself is requested from the RelayManager
+ * (relay_manager.h): a run that does not fit the load budget is QUEUED and
+ * its timer only starts once the relay is switched on.
+ */
+
+#ifndef PUMP_ENGINE_H
+#define PUMP_ENGINE_H
+
+#include "relay_manager.h"
+#include <stdint.h>
+
+// Identifies one pump run. Handles wrap after 255 runs; 0 is never issued.
+typedef uint8_t PumpRunHandle;
+constexpr PumpRunHandle PUMP_RUN_NONE = 0;
+
+enum class PumpRunStatus : uint8_t {
+  UNKNOWN,   // Handle never issued or already superseded by a newer run
+  QUEUED,    // Waiting for load budget, relay still off
+  RUNNING,   // Relay is on, deadline not reached yet
+  COMPLETED, // Stopped by the tick at its deadline
+  ABORTED    // Stopped early by stopPumpRun()/abortPumpRuns()
+};
+
+/**
+ * Completion callback, invoked from the tick (or the stop call) right after
+ * the relay has been switched off.
+ * @param handle Handle of the finished run
+ * @param status COMPLETED or ABORTED
+ * @param ranMs Measured on-time in ms
+ */
+typedef void (*PumpRunCallback)(PumpRunHandle handle, PumpRunStatus status, uint32_t ranMs);
+
+/**
+ * Start a timed pump run.
+ * @param pumpPin Relay pin (one of DOSING_PUMP_PINS; the inlet/outlet are
+ *        driven by the level controller through setLetPump())
+ * @param durationMs Requested on-time in ms, 1..MAX_PUMP_RUN_TIME_MS (clamped)
+ * @param onDone Optional completion callback (nullptr = poll the handle)
+ * @param priority Queue priority while the load budget is exhausted
+ * @return Run handle, or PUMP_RUN_NONE if the relay already has a run,
+ *         is not managed, or durationMs == 0
+ * Side effects: switches the relay on immediately if the budget allows,
+ * otherwise the run is QUEUED.
+ */
+PumpRunHandle startPumpRun(uint8_t pumpPin, uint16_t durationMs, PumpRunCallback onDone = nullptr,
+                           RelayPriority priority = RelayPriority::DOSING);
+
+/**
+ * Engine tick (PUMPS task body). Switches relays off once their deadline has
+ * passed (firing the completion callbacks), lets the RelayManager grant
+ * waiting requests and starts the timers of runs whose relay came on.
+ */
+void updatePumpRuns();
+
+/**
+ * Stop a run before its deadline (or drop it from the queue).
+ * @return true if the handle was queued or running and has been stopped
+ */
+bool stopPumpRun(PumpRunHandle handle);
+
+/**
+ * Stop every queued and running run (emergency path). No-op when idle.
+ */
+void abortPumpRuns();
+
+/**
+ * Status of a run. The latest run of every relay is tracked; older
+ * handles report UNKNOWN.
+ */
+PumpRunStatus getPumpRunStatus(PumpRunHandle handle);
+
+/**
+ * @return true while any pump run is queued or running
+ */
+bool isPumpRunActive();
+
+#endif // PUMP_ENGINE_H
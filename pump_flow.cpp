@@ -0,0 +1,160 @@
+/**
+ * ============================================================================
+ * PUMP_FLOW.CPP - Dosing Pump Flow Model
+ * ============================================================================
+ */
+
+#include "pump_flow.h"
+#include "debug.hpp"
+#include "hardware.h"
+#include "pump_engine.h"
+#include "pumps.h"
+#include "storage.h"
+#include <Arduino.h>
+
+namespace {
+
+constexpr uint8_t DOSING_PUMPS = Hardware::DOSING_PUMP_COUNT;
+constexpr uint16_t NOMINAL_RATE_Q8 = Hardware::PUMP_FLOW_RATE_ML_PER_SEC * 256U;
+constexpr uint32_t MS_PER_ML_SCALE = 1000UL * 256UL * 256UL; // ms * Q8 rate * Q8 result
+
+static_assert(Hardware::FLOW_CALIBRATION_RUN_MS <= Hardware::MAX_PUMP_RUN_TIME_MS,
+              "a calibration run must fit one pump run");
+// 24.8 ms/ml at the slowest rate times the largest amount must fit 32 bits
+static_assert(MS_PER_ML_SCALE / Hardware::FLOW_RATE_MIN_Q8 / 256UL <= 0xFFFFFFFFUL / 0xFFFFUL,
+              "slowest flow rate overflows the dose duration");
+
+struct PumpFlowCalibration {
+  uint16_t rateQ8[DOSING_PUMPS]; // ml/s * 256
+};
+
+PumpFlowCalibration flow;
+uint32_t msPerMlQ8[DOSING_PUMPS]; // 1000 / rate, 24.8 fixed point
+
+PumpRunHandle calibrationRun = PUMP_RUN_NONE;
+uint8_t calibrationPump = 0;
+uint32_t calibrationRanMs = 0; // On-time of the last finished run, 0 = none
+
+// The only division of the model; runs when a rate changes.
+void applyRate(uint8_t pump, uint16_t rateQ8) {
+  flow.rateQ8[pump] = rateQ8;
+  msPerMlQ8[pump] = MS_PER_ML_SCALE / rateQ8;
+}
+
+bool rateUsable(uint32_t rateQ8) {
+  return rateQ8 >= Hardware::FLOW_RATE_MIN_Q8 && rateQ8 <= Hardware::FLOW_RATE_MAX_Q8;
+}
+
+void applyNominalRates() {
+  for (uint8_t i = 0; i < DOSING_PUMPS; i++)
+    applyRate(i, NOMINAL_RATE_Q8);
+}
+
+void onCalibrationRunDone(PumpRunHandle, PumpRunStatus status, uint32_t ranMs) {
+  calibrationRun = PUMP_RUN_NONE;
+  if (status == PumpRunStatus::ABORTED) {
+    // Stopped early: the measured volume would not match a full run
+    SerialPrint(PUMPS, "WARN flow calibration run aborted pump=", calibrationPump + 1,
+                " ranMs=", ranMs, "; run it again");
+    return;
+  }
+  if (ranMs < Hardware::FLOW_CALIBRATION_MIN_RUN_MS) {
+    SerialPrint(PUMPS, "WARN flow calibration run too short pump=", calibrationPump + 1,
+                " ranMs=", ranMs);
+    return;
+  }
+  calibrationRanMs = ranMs;
+  SerialPrint(PUMPS, "Flow calibration run done pump=", calibrationPump + 1, " ranMs=", ranMs,
+              "; enter the measured volume: flow ml ", calibrationPump + 1, " <ml>");
+}
+
+} // namespace
+
+void initPumpFlow() {
+  applyNominalRates();
+  PumpFlowCalibration stored;
+  if (!loadRecord(EepromMap::PUMP_FLOW_ADDR, &stored, sizeof(stored))) {
+    SerialPrint(PUMPS, "No flow calibration stored; nominal rate for every pump");
+    return;
+  }
+  for (uint8_t i = 0; i < DOSING_PUMPS; i++) {
+    if (rateUsable(stored.rateQ8[i]))
+      applyRate(i, stored.rateQ8[i]);
+  }
+  printPumpFlow();
+}
+
+uint32_t doseDurationMs(uint8_t pumpIndex, uint16_t amountMl) {
+  if (pumpIndex >= DOSING_PUMPS)
+    return 0;
+  uint32_t factor = msPerMlQ8[pumpIndex];
+  return amountMl * (factor >> 8) + ((amountMl * (factor & 0xFFU)) >> 8);
+}
+
+uint16_t deliveredVolumeMl(uint8_t pumpIndex, uint32_t ranMs) {
+  if (pumpIndex >= DOSING_PUMPS)
+    return 0;
+  // Whole seconds and the remainder separately keep the products in 32 bits
+  uint32_t rate = flow.rateQ8[pumpIndex];
+  uint32_t wholeSeconds = ranMs / 1000UL;
+  if (wholeSeconds >= 0xFFFFFFFFUL / Hardware::FLOW_RATE_MAX_Q8 - 1)
+    return 0xFFFF;
+  uint32_t ml = (wholeSeconds * rate + (ranMs % 1000UL) * rate / 1000UL) >> 8;
+  return ml > 0xFFFFUL ? 0xFFFF : static_cast<uint16_t>(ml);
+}
+
+uint16_t getPumpFlowRateQ8(uint8_t pumpIndex) {
+  return pumpIndex < DOSING_PUMPS ? flow.rateQ8[pumpIndex] : 0;
+}
+
+bool startFlowCalibration(uint8_t pumpIndex) {
+  if (pumpIndex >= DOSING_PUMPS || calibrationRun != PUMP_RUN_NONE)
+    return false;
+  PumpRunHandle run = startPumpRun(pumpIndexToPin(pumpIndex), Hardware::FLOW_CALIBRATION_RUN_MS,
+                                   onCalibrationRunDone);
+  if (run == PUMP_RUN_NONE)
+    return false;
+  calibrationRun = run;
+  calibrationPump = pumpIndex;
+  calibrationRanMs = 0;
+  SerialPrint(PUMPS, "Flow calibration run started pump=", pumpIndex + 1,
+              " ms=", Hardware::FLOW_CALIBRATION_RUN_MS);
+  return true;
+}
+
+bool setMeasuredFlowVolume(uint8_t pumpIndex, uint16_t volumeMl) {
+  if (pumpIndex != calibrationPump || calibrationRanMs == 0) {
+    SerialPrint(PUMPS, "WARN no finished flow calibration run for pump=", pumpIndex + 1);
+    return false;
+  }
+  // volume * 256000 fits 32 bits up to 16777 ml, far above any usable rate
+  uint32_t rateQ8 = volumeMl < 16000U ? volumeMl * 256000UL / calibrationRanMs : 0xFFFFFFFFUL;
+  if (!rateUsable(rateQ8)) {
+    SerialPrint(PUMPS, "WARN flow rate out of range pump=", pumpIndex + 1, " rateQ8=", rateQ8);
+    return false;
+  }
+  applyRate(pumpIndex, static_cast<uint16_t>(rateQ8));
+  storeRecord(EepromMap::PUMP_FLOW_ADDR, &flow, sizeof(flow));
+  calibrationRanMs = 0;
+  SerialPrint(PUMPS, "Flow calibration stored pump=", pumpIndex + 1, " volumeMl=", volumeMl,
+              " rateQ8=", rateQ8);
+  return true;
+}
+
+void resetPumpFlow() {
+  if (calibrationRun != PUMP_RUN_NONE)
+    stopPumpRun(calibrationRun);
+  calibrationRanMs = 0;
+  applyNominalRates();
+  eraseRecord(EepromMap::PUMP_FLOW_ADDR, sizeof(flow));
+  SerialPrint(PUMPS, "Flow calibration reset to the nominal rate");
+}
+
+// ml/s with two decimals, e.g. "2.00"; one line per pump
+void printPumpFlow() {
+  for (uint8_t i = 0; i < DOSING_PUMPS; i++) {
+    uint16_t hundredths = static_cast<uint16_t>((flow.rateQ8[i] * 100UL + 128U) >> 8);
+    SerialPrint(PUMPS, "flow pump=", i + 1, " mlPerSec=", hundredths / 100,
+                hundredths % 100 < 10 ? ".0" : ".", hundredths % 100);
+  }
+}
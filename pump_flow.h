@@ -0,0 +1,72 @@
+/**
+ * ============================================================================
+ * PUMP_FLOW.H - Dosing Pump Flow Model
+ * ============================================================================
+ *
+ * Every dose timing comes from here: each dosing pump has its own flow rate
+ * in 1/256 ml/s, PUMP_FLOW_RATE_ML_PER_SEC until it is calibrated. A
+ * calibration runs the pump for FLOW_CALIBRATION_RUN_MS; the volume caught
+ * in a measuring cup is then entered on the serial console and the rate
+ * (volume / measured on-time) is stored in EEPROM.
+ *
+ * Durations use a per-pump ms-per-ml factor derived when the rate changes,
+ * so a dose costs two 32-bit multiplications and no division.
+ */
+
+#ifndef PUMP_FLOW_H
+#define PUMP_FLOW_H
+
+#include <stdint.h>
+
+/**
+ * Load the stored flow rates (nominal for pumps never calibrated).
+ */
+void initPumpFlow();
+
+/**
+ * Pump on-time that delivers a volume at the pump's flow rate.
+ * @param pumpIndex 0..DOSING_PUMP_COUNT-1
+ * @param amountMl Volume in ml
+ * @return Duration in ms, not clamped to MAX_PUMP_RUN_TIME_MS; 0 for an
+ *         invalid pump
+ */
+uint32_t doseDurationMs(uint8_t pumpIndex, uint16_t amountMl);
+
+/**
+ * Volume a pump delivers in a given on-time at its flow rate.
+ * @return Volume in ml, rounded down (0 for an invalid pump)
+ */
+uint16_t deliveredVolumeMl(uint8_t pumpIndex, uint32_t ranMs);
+
+/**
+ * @return Flow rate of a dosing pump in 1/256 ml/s (0 for an invalid pump)
+ */
+uint16_t getPumpFlowRateQ8(uint8_t pumpIndex);
+
+/**
+ * Start the timed calibration run of one dosing pump. Catch its output and
+ * pass the volume to setMeasuredFlowVolume() once the run has finished.
+ * @return false if another calibration run is active or the relay is busy
+ */
+bool startFlowCalibration(uint8_t pumpIndex);
+
+/**
+ * Turn the measured output of the pump's last calibration run into its
+ * flow rate and store it.
+ * @param volumeMl Volume delivered during the run, in ml
+ * @return false without a finished run of this pump or for a rate outside
+ *         FLOW_RATE_MIN_Q8..FLOW_RATE_MAX_Q8 (previous rate kept)
+ */
+bool setMeasuredFlowVolume(uint8_t pumpIndex, uint16_t volumeMl);
+
+/**
+ * Return every pump to the nominal rate and erase the stored rates.
+ */
+void resetPumpFlow();
+
+/**
+ * Print the flow rate of every dosing pump in ml/s (one line per pump).
+ */
+void printPumpFlow();
+
+#endif // PUMP_FLOW_H
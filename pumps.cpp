@@ -6,8 +6,11 @@
 
 #include "appstate.h"
 #include "debug.hpp"
+#include "dose_ledger.h"
+#include "dosing_planner.h"
+#include "pump_engine.h"
+#include "pump_flow.h"
 #include "pumps.h"
-#include "screens.h"
 #include "water.h"
 #include <Arduino.h>
 
@@ -16,76 +19,167 @@ void initPumpModes() {
     AppState::pumps[3].setRole(PumpRole::INLET);
     AppState::pumps[4].setRole(PumpRole::OUTLET);
   }
-
-  for (uint8_t i = 0; i <= Hardware::DOSING_PUMP_COUNT; i++) {
-    pinMode(Hardware::DOSING_PUMP_PINS[i], OUTPUT);
-    digitalWrite(Hardware::DOSING_PUMP_PINS[i], HIGH);
-  }
 }
 
-static uint8_t pumpIndexToPin(uint8_t pumpIndex) {
+uint8_t pumpIndexToPin(uint8_t pumpIndex) {
   if (pumpIndex < Hardware::DOSING_PUMP_COUNT) {
     return Hardware::DOSING_PUMP_PINS[pumpIndex];
   }
   return 0;
 }
 
-void checkDosingSchedule() {
-  uint64_t now = seconds();
-  for (uint8_t i = 0; i < Hardware::DOSING_PUMP_COUNT; ++i) {
-    Pump& p = AppState::pumps[i];
-    if (p.getRole() != PumpRole::DOSING)
-      continue;
+// A dose longer than one pump run is delivered as equal pulses of at most
+// MAX_PUMP_RUN_TIME_MS with DOSE_PULSE_GAP_MS cool-down gaps between them.
+struct DoseSession {
+  bool active;
+  bool finished;          // Last pulse done, ledger entry not written yet
+  DoseOutcome outcome;
+  PumpRunHandle run;      // Pulse running, PUMP_RUN_NONE during a gap
+  uint32_t remainingMs;   // On-time still to deliver
+  uint32_t ranMs;         // Measured on-time of the finished pulses
+  uint32_t nextPulseAtMs; // millis() when the gap ends
+  uint16_t pulseMs;       // Planned length of every pulse
+  uint16_t pulses;        // Pulses started
+  uint16_t requestedMl;
+};
+
+static DoseSession doses[Hardware::DOSING_PUMP_COUNT] = {};
+static uint8_t dosesInGap = 0;    // Sessions waiting for their next pulse
+static uint8_t dosesFinished = 0; // Sessions waiting for their ledger entry
+
+static void onPulseFinished(PumpRunHandle handle, PumpRunStatus status, uint32_t ranMs);
+
+static bool startPulse(uint8_t pumpIndex) {
+  DoseSession& d = doses[pumpIndex];
+  uint16_t pulseMs = d.remainingMs < d.pulseMs ? static_cast<uint16_t>(d.remainingMs) : d.pulseMs;
+  d.run = startPumpRun(pumpIndexToPin(pumpIndex), pulseMs, onPulseFinished);
+  if (d.run == PUMP_RUN_NONE)
+    return false;
+  d.pulses++;
+  SerialPrint(PUMPS, "Dose pulse pump=", pumpIndex + 1, " n=", d.pulses, " ms=", pulseMs,
+              " remainingMs=", d.remainingMs);
+  return true;
+}
 
-    DosingConfig cfg = p.getConfig();
-    if (cfg.interval == 0 || !p.shouldDose(now))
-      continue;
+// Reports the volume the finished pulses delivered and closes the session.
+// Runs from the DOSING task: the ledger write (~26 ms) does not fit the
+// PUMPS task the pulse callback runs in.
+static void finishDose(uint8_t pumpIndex) {
+  DoseSession& d = doses[pumpIndex];
+  d.active = false;
+  d.finished = false;
+  uint16_t deliveredMl = deliveredVolumeMl(pumpIndex, d.ranMs);
+  SerialPrint(PUMPS, "Dose done pump=", pumpIndex + 1, " requestedMl=", d.requestedMl,
+              " deliveredMl=", deliveredMl, " pulses=", d.pulses, " ranMs=", d.ranMs,
+              d.outcome == DoseOutcome::COMPLETED ? " status=COMPLETED" : " status=ABORTED");
+  recordDose(pumpIndex, deliveredMl, d.outcome);
+}
 
-    if (cfg.amount == 0) {
-      cfg.lastTime = now;
-      p.setConfig(cfg);
+static void onPulseFinished(PumpRunHandle handle, PumpRunStatus status, uint32_t ranMs) {
+  for (uint8_t i = 0; i < Hardware::DOSING_PUMP_COUNT; i++) {
+    DoseSession& d = doses[i];
+    if (!d.active || d.run != handle)
       continue;
+    d.run = PUMP_RUN_NONE;
+    d.ranMs += ranMs;
+    d.remainingMs -= d.remainingMs < d.pulseMs ? d.remainingMs : d.pulseMs;
+    if (status != PumpRunStatus::COMPLETED || d.remainingMs == 0) {
+      d.finished = true;
+      d.outcome = status == PumpRunStatus::COMPLETED ? DoseOutcome::COMPLETED : DoseOutcome::ABORTED;
+      dosesFinished++;
+      return;
     }
+    d.nextPulseAtMs = millis() + Hardware::DOSE_PULSE_GAP_MS;
+    dosesInGap++;
+    return;
+  }
+}
 
-    uint64_t durationMs = (static_cast<uint64_t>(cfg.amount) * 1000ULL) /
-                          static_cast<uint64_t>(Hardware::PUMP_FLOW_RATE_ML_PER_SEC);
-    if (durationMs > Hardware::MAX_PUMP_RUN_TIME_MS)
-      durationMs = Hardware::MAX_PUMP_RUN_TIME_MS;
-
-    cfg.duration = durationMs;
-    cfg.lastTime = now;
-    p.setConfig(cfg);
+static void finishDoses() {
+  for (uint8_t i = 0; i < Hardware::DOSING_PUMP_COUNT; i++) {
+    if (doses[i].finished) {
+      finishDose(i);
+      dosesFinished--;
+    }
+  }
+}
 
-    uint8_t pin = pumpIndexToPin(i);
-    runPumpSafely(pin, static_cast<uint16_t>(durationMs));
+// Starts the next pulse of every session whose cool-down has ended; a busy
+// relay is retried on the next tick.
+static void advanceDosePulses() {
+  uint32_t nowMs = millis();
+  for (uint8_t i = 0; i < Hardware::DOSING_PUMP_COUNT; i++) {
+    DoseSession& d = doses[i];
+    if (!d.active || d.finished || d.run != PUMP_RUN_NONE ||
+        static_cast<int32_t>(nowMs - d.nextPulseAtMs) < 0)
+      continue;
+    if (startPulse(i))
+      dosesInGap--;
   }
 }
 
-Pump::Pump() {}
+// Ledger STARTED entry, last dose time and the next due time.
+static void commitDoseStart(uint8_t pumpIndex, uint32_t now, uint32_t durationMs) {
+  Pump& p = AppState::pumps[pumpIndex];
+  DosingConfig cfg = p.getConfig();
+  recordDose(pumpIndex, cfg.amount, DoseOutcome::STARTED);
+  cfg.duration = durationMs;
+  cfg.lastTime = now;
+  p.setConfig(cfg);
+  replanDose(pumpIndex);
+}
+
+// A dose without run time (no amount, or no usable flow rate) is recorded as
+// aborted with nothing delivered, and the pump waits for its next interval.
+static void skipDose(uint8_t pumpIndex, uint32_t now) {
+  SerialPrint(PUMPS, "WARN dose skipped pump=", pumpIndex + 1, " amountMl=",
+              AppState::pumps[pumpIndex].getConfig().amount, " durationMs=0");
+  commitDoseStart(pumpIndex, now, 0);
+  recordDose(pumpIndex, 0, DoseOutcome::ABORTED);
+}
 
-int32_t Pump::edit(uint8_t pumpIndex, const char* amountTitle) {
-  if (role != PumpRole::DOSING)
-    return -1;
-  return pumpAmountScreen(amountTitle, pumpIndex, true, config.amount);
+// Starts one dose; false if the pump is still delivering the previous one
+// or its relay is busy.
+static bool startDose(uint8_t pumpIndex, uint32_t now) {
+  uint16_t amountMl = AppState::pumps[pumpIndex].getConfig().amount;
+  DoseSession& d = doses[pumpIndex];
+  if (d.active)
+    return false;
+  uint32_t durationMs = doseDurationMs(pumpIndex, amountMl);
+  if (durationMs == 0) {
+    skipDose(pumpIndex, now);
+    return true;
+  }
+  uint32_t pulses = (durationMs + Hardware::MAX_PUMP_RUN_TIME_MS - 1) / Hardware::MAX_PUMP_RUN_TIME_MS;
+  d = DoseSession{true, false, DoseOutcome::STARTED, PUMP_RUN_NONE, durationMs, 0, 0, 0, 0,
+                  amountMl};
+  d.pulseMs = static_cast<uint16_t>((durationMs + pulses - 1) / pulses);
+  if (!startPulse(pumpIndex)) {
+    d.active = false;
+    return false;
+  }
+  commitDoseStart(pumpIndex, now, durationMs);
+  return true;
 }
 
-int32_t Pump::viewEdit(uint8_t pumpIndex, const char* amountTitle) {
-  if (role != PumpRole::DOSING)
-    return -1;
-  return pumpAmountScreen(amountTitle, pumpIndex, false, config.amount);
+void checkDosingSchedule() {
+  uint32_t now = doseClockNow();
+  uint8_t pumpIndex;
+  if (dosesFinished != 0)
+    finishDoses();
+  while (nextDueDose(now, &pumpIndex)) {
+    if (!startDose(pumpIndex, now))
+      deferDose(pumpIndex, now + 1); // Previous dose or relay still busy: retry next tick
+  }
+  if (dosesInGap != 0)
+    advanceDosePulses();
+  checkpointDoseClock(now);
 }
 
+Pump::Pump() {}
+
 void Pump::setConfig(const DosingConfig& c) { config = c; }
 DosingConfig Pump::getConfig() const { return config; }
 
 void Pump::setRole(PumpRole r) { role = r; }
 PumpRole Pump::getRole() const { return role; }
-
-bool Pump::shouldDose(uint64_t currentSeconds) const {
-  if (config.interval == 0)
-    return false;
-  uint64_t intervalSeconds = static_cast<uint64_t>(config.interval) * 86400ULL;
-  if (currentSeconds < config.lastTime)
-    return true;
-  return (currentSeconds - config.lastTime) >= intervalSeconds;
-}
@@ -23,24 +23,19 @@ struct DosingConfig {
   uint16_t amount = 0;
   uint64_t duration = 0;
   uint64_t interval = 0;
-  uint64_t lastTime = 0;
+  uint64_t lastTime = 0; // Dose clock of the last dose (dose_ledger.h), 0 = none
 };
 
 class Pump {
 public:
   Pump();
 
-  int32_t edit(uint8_t pumpIndex, const char* amountTitle);
-  int32_t viewEdit(uint8_t pumpIndex, const char* amountTitle);
-
   void setConfig(const DosingConfig& config);
   DosingConfig getConfig() const;
 
   void setRole(PumpRole role);
   PumpRole getRole() const;
 
-  bool shouldDose(uint64_t currentSeconds) const;
-
 private:
   DosingConfig config;
   PumpRole role = PumpRole::DOSING;
@@ -53,14 +48,25 @@ private:
 void initPumpModes();
 
 /**
- * Activate a pump for a specified duration
- * @param pump_pin Digital pin connected to the pump relay/control
- * @param duration_ms How long to run the pump in milliseconds
+ * Relay pin of a dosing pump.
+ * @param pumpIndex 0..DOSING_PUMP_COUNT-1
+ * @return Pin number, or 0 for an index without a dosing pump
  */
-void pumpWork(uint8_t pump_pin, uint16_t duration_ms);
-void runPumpSafely(uint8_t pump_pin, uint16_t duration_ms);
+uint8_t pumpIndexToPin(uint8_t pumpIndex);
 
-// Periodic scheduler for automatic dosing pumps
+/**
+ * Dosing task body. Compares the head of the dosing queue (see
+ * dosing_planner.h) with the dose clock and starts every due dose through
+ * the pump engine (see pump_engine.h); doses beyond the relay load budget
+ * queue there and overlap otherwise. A dose longer than
+ * MAX_PUMP_RUN_TIME_MS runs as equal pulses separated by DOSE_PULSE_GAP_MS,
+ * each a separate engine run, and its end reports the volume the pulses
+ * delivered. A pump whose relay (or previous dose) is still busy is
+ * deferred to the next tick.
+ * Side effects: pump relay on, DosingConfig.lastTime/duration updated, the
+ * pump replanned, start and end of every dose appended to the dose ledger,
+ * dose clock checkpointed.
+ */
 void checkDosingSchedule();
 
 #endif
@@ -0,0 +1,182 @@
+/**
+ * ============================================================================
+ * RELAY_MANAGER.CPP - Pump Relay Resource Manager
+ * ============================================================================
+ */
+
+#include "relay_manager.h"
+#include "actuator_stats.h"
+#include "debug.hpp"
+#include <Arduino.h>
+
+static_assert(Hardware::LET_PUMP_LOAD_MA <= Hardware::RELAY_LOAD_BUDGET_MA &&
+                  Hardware::DOSING_PUMP_LOAD_MA <= Hardware::RELAY_LOAD_BUDGET_MA,
+              "every single pump must fit the relay load budget");
+
+namespace {
+
+enum class RelayState : uint8_t { OFF, WAITING, ON };
+
+struct Relay {
+  uint8_t pin;
+  uint16_t loadMa;
+  RelayState state;
+  RelayPriority priority;
+  uint8_t ticket;     // Arrival order among waiting requests (wraps)
+  uint32_t onSinceMs; // millis() when switched on
+  uint32_t onTimeMs;  // Accumulated on-time of finished runs
+};
+
+Relay relays[RELAY_COUNT];
+uint16_t loadMa = 0;      // Sum of loads of relays that are ON
+uint8_t nextTicket = 0;
+
+const __FlashStringHelper* stateName(RelayState state) {
+  switch (state) {
+  case RelayState::OFF:     return F("OFF");
+  case RelayState::WAITING: return F("WAITING");
+  case RelayState::ON:      return F("ON");
+  default:                  return F("UNKNOWN");
+  }
+}
+
+void setState(Relay& r, RelayState next) {
+  SerialPrint(PUMPS, "Relay pin=", r.pin, " ", stateName(r.state), " -> ", stateName(next),
+              " loadMa=", loadMa, "/", Hardware::RELAY_LOAD_BUDGET_MA);
+  r.state = next;
+}
+
+void switchOn(Relay& r) {
+  loadMa += r.loadMa;
+  r.onSinceMs = millis();
+  digitalWrite(r.pin, LOW);
+  setState(r, RelayState::ON);
+  ActuatorStats::switched(static_cast<uint8_t>(&r - relays), true);
+}
+
+void switchOff(Relay& r) {
+  digitalWrite(r.pin, HIGH);
+  loadMa -= r.loadMa;
+  r.onTimeMs += millis() - r.onSinceMs;
+  setState(r, RelayState::OFF);
+  ActuatorStats::switched(static_cast<uint8_t>(&r - relays), false);
+}
+
+// Waiting request that is served next: lowest priority value, then the
+// oldest ticket (wrap-aware). nullptr if nothing waits.
+Relay* queueHead() {
+  Relay* head = nullptr;
+  for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+    Relay& r = relays[i];
+    if (r.state != RelayState::WAITING)
+      continue;
+    if (head == nullptr || r.priority < head->priority ||
+        (r.priority == head->priority && static_cast<int8_t>(r.ticket - head->ticket) < 0))
+      head = &r;
+  }
+  return head;
+}
+
+Relay* find(uint8_t pin) {
+  uint8_t idx = RelayManager::relayIndex(pin);
+  return idx == RELAY_NONE ? nullptr : &relays[idx];
+}
+
+} // namespace
+
+namespace RelayManager {
+
+void init() {
+  for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+    bool dosing = i < Hardware::DOSING_PUMP_COUNT;
+    uint8_t pin = dosing ? Hardware::DOSING_PUMP_PINS[i]
+                         : (i == Hardware::DOSING_PUMP_COUNT ? Hardware::INLET_PUMP_PIN
+                                                             : Hardware::OUTLET_PUMP_PIN);
+    relays[i] = {pin, dosing ? Hardware::DOSING_PUMP_LOAD_MA : Hardware::LET_PUMP_LOAD_MA,
+                 RelayState::OFF, RelayPriority::DOSING, 0, 0, 0};
+    digitalWrite(pin, HIGH);
+    pinMode(pin, OUTPUT);
+  }
+  loadMa = 0;
+}
+
+bool request(uint8_t pin, RelayPriority priority) {
+  Relay* r = find(pin);
+  if (r == nullptr)
+    return false;
+  if (r->state == RelayState::OFF) {
+    r->priority = priority;
+    r->ticket = nextTicket++;
+    setState(*r, RelayState::WAITING);
+    update();
+  }
+  return r->state == RelayState::ON;
+}
+
+void release(uint8_t pin) {
+  Relay* r = find(pin);
+  if (r == nullptr || r->state == RelayState::OFF)
+    return;
+  if (r->state == RelayState::ON)
+    switchOff(*r);
+  else
+    setState(*r, RelayState::OFF);
+  update();
+}
+
+void releaseAll() {
+  for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+    if (relays[i].state == RelayState::ON)
+      switchOff(relays[i]);
+    relays[i].state = RelayState::OFF;
+    digitalWrite(relays[i].pin, HIGH);
+  }
+}
+
+void update() {
+  for (Relay* head = queueHead(); head != nullptr; head = queueHead()) {
+    if (loadMa + head->loadMa > Hardware::RELAY_LOAD_BUDGET_MA)
+      return; // Head waits for budget; nothing behind it may overtake
+    switchOn(*head);
+  }
+}
+
+bool isOn(uint8_t pin) {
+  Relay* r = find(pin);
+  return r != nullptr && r->state == RelayState::ON;
+}
+
+bool isWaiting(uint8_t pin) {
+  Relay* r = find(pin);
+  return r != nullptr && r->state == RelayState::WAITING;
+}
+
+uint8_t relayIndex(uint8_t pin) {
+  for (uint8_t i = 0; i < RELAY_COUNT; i++) {
+    if (relays[i].pin == pin)
+      return i;
+  }
+  return RELAY_NONE;
+}
+
+uint16_t committedLoadMa() { return loadMa; }
+
+uint32_t onTimeMs(uint8_t pin) {
+  Relay* r = find(pin);
+  if (r == nullptr)
+    return 0;
+  uint32_t total = r->onTimeMs;
+  if (r->state == RelayState::ON)
+    total += millis() - r->onSinceMs;
+  return total;
+}
+
+void resetOnTime(uint8_t pin) {
+  Relay* r = find(pin);
+  if (r == nullptr)
+    return;
+  r->onTimeMs = 0;
+  r->onSinceMs = millis();
+}
+
+} // namespace RelayManager
@@ -0,0 +1,97 @@
+/**
+ * ============================================================================
+ * RELAY_MANAGER.H - Pump Relay Resource Manager
+ * ============================================================================
+ *
+ * Owns every pump relay: the dosing pumps (Hardware::DOSING_PUMP_PINS), the
+ * inlet and the outlet. Callers request a relay instead of writing its pin;
+ * independent pumps run concurrently as long as the sum of their nominal
+ * loads stays within Hardware::RELAY_LOAD_BUDGET_MA. Requests that do not
+ * fit wait in a queue ordered by priority (drain/fill safety before dosing),
+ * then by arrival. The head of the queue is never overtaken, so a waiting
+ * inlet/outlet request cannot be starved by a stream of small doses.
+ *
+ * Relays are active LOW: LOW = pump on, HIGH = pump off.
+ */
+
+#ifndef RELAY_MANAGER_H
+#define RELAY_MANAGER_H
+
+#include "hardware.h"
+#include <stdint.h>
+
+// Dosing relays, then inlet and outlet
+constexpr uint8_t RELAY_COUNT = Hardware::DOSING_PUMP_COUNT + 2;
+constexpr uint8_t RELAY_NONE = 0xFF;
+
+// Queue order for waiting requests (lower value is granted first)
+enum class RelayPriority : uint8_t {
+  SAFETY, // Level correction and water change (inlet/outlet)
+  DOSING  // Dosing runs, manual runs and line priming
+};
+
+namespace RelayManager {
+
+/**
+ * Configure every relay pin as an output and switch it off.
+ */
+void init();
+
+/**
+ * Ask for a relay to be switched on. Granted at once if the load fits and
+ * no earlier request is waiting, otherwise queued until update() grants it.
+ * Repeated requests for a relay that is on or waiting are no-ops.
+ * @return true if the relay is on when the call returns
+ */
+bool request(uint8_t pin, RelayPriority priority);
+
+/**
+ * Switch a relay off, or drop its waiting request. Frees its load budget.
+ */
+void release(uint8_t pin);
+
+/**
+ * Emergency path: switch every relay off and clear the queue.
+ */
+void releaseAll();
+
+/**
+ * Grant waiting requests that now fit the budget (PUMPS task, through
+ * updatePumpRuns()).
+ */
+void update();
+
+/**
+ * @return true while the relay is switched on
+ */
+bool isOn(uint8_t pin);
+
+/**
+ * @return true while a request for the relay waits for budget
+ */
+bool isWaiting(uint8_t pin);
+
+/**
+ * @return Index 0..RELAY_COUNT-1 of a managed relay, or RELAY_NONE
+ */
+uint8_t relayIndex(uint8_t pin);
+
+/**
+ * @return Sum of the nominal loads of the relays that are on, mA
+ */
+uint16_t committedLoadMa();
+
+/**
+ * Accumulated on-time of a relay, including the current run.
+ * @return ms (wraps after ~49 days)
+ */
+uint32_t onTimeMs(uint8_t pin);
+
+/**
+ * Zero the accumulated on-time of a relay.
+ */
+void resetOnTime(uint8_t pin);
+
+} // namespace RelayManager
+
+#endif // RELAY_MANAGER_H
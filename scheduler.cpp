@@ -0,0 +1,178 @@
+/**
+ * ============================================================================
+ * SCHEDULER.CPP - Cooperative Deadline-Driven Task Scheduler
+ * ============================================================================
+ */
+
+#include "scheduler.h"
+#include "debug.hpp"
+#include "latency.h"
+#include <Arduino.h>
+
+static_assert(TASK_COUNT <= 8, "dispatch() tracks served tasks in a uint8_t mask");
+
+namespace {
+
+// Minimum spacing between two overrun reports of the same task. Serial at
+// 9600 baud costs ~1 ms per character, so unthrottled reports would
+// themselves cause the next overrun.
+constexpr uint16_t OVERRUN_LOG_INTERVAL_MS = 5000;
+
+struct Task {
+  TaskFunction fn;
+  uint32_t releaseMs;        // Absolute time of the pending release
+  uint32_t lastOverrunLogMs; // Throttle for overrun reports
+  uint16_t periodMs;
+  uint16_t deadlineMs;
+  bool running;              // Guards against nested dispatch re-entering it
+  TaskStats stats;
+};
+
+Task tasks[TASK_COUNT];
+
+uint8_t slotOf(TaskId id) { return static_cast<uint8_t>(id); }
+
+uint16_t clampMs(uint32_t ms) { return ms > 0xFFFFUL ? 0xFFFF : static_cast<uint16_t>(ms); }
+
+bool isReleased(const Task& t, uint32_t now) {
+  return t.fn != nullptr && !t.running && static_cast<int32_t>(now - t.releaseMs) >= 0;
+}
+
+// Signed time left until the absolute deadline of the pending release.
+int32_t slackMs(const Task& t, uint32_t now) {
+  return static_cast<int32_t>(t.releaseMs + t.deadlineMs - now);
+}
+
+// Earliest-deadline-first pick among released tasks not yet served in this
+// dispatch round. Returns -1 when nothing is due.
+int8_t pickNextTask(uint32_t now, uint8_t servedMask) {
+  int8_t best = -1;
+  int32_t bestSlack = 0;
+  for (uint8_t i = 0; i < TASK_COUNT; i++) {
+    if ((servedMask & (1U << i)) || !isReleased(tasks[i], now))
+      continue;
+    int32_t slack = slackMs(tasks[i], now);
+    if (best < 0 || slack < bestSlack) {
+      best = static_cast<int8_t>(i);
+      bestSlack = slack;
+    }
+  }
+  return best;
+}
+
+void reportOverrun(uint8_t idx, uint32_t now) {
+  Task& t = tasks[idx];
+  t.stats.overrunCount++;
+  if (t.stats.overrunCount > 1 && now - t.lastOverrunLogMs < OVERRUN_LOG_INTERVAL_MS)
+    return;
+  t.lastOverrunLogMs = now;
+  SerialPrint(SCHEDULER, "WARN task=", Scheduler::taskName(static_cast<TaskId>(idx)),
+              " overrun durationMs=", t.stats.lastDurationMs, " deadlineMs=", t.deadlineMs,
+              " overruns=", t.stats.overrunCount);
+}
+
+// Move the release forward by one period. A task that is still a full period
+// behind after that has its backlog collapsed into a single release; the
+// skipped release counts as an overrun.
+void advanceRelease(uint8_t idx, uint32_t now) {
+  Task& t = tasks[idx];
+  t.releaseMs += t.periodMs;
+  if (static_cast<int32_t>(now - t.releaseMs) >= static_cast<int32_t>(t.periodMs)) {
+    t.releaseMs = now;
+    reportOverrun(idx, now);
+  }
+}
+
+void runTask(uint8_t idx) {
+  Task& t = tasks[idx];
+  uint32_t start = millis();
+  t.stats.maxLatenessMs = max(t.stats.maxLatenessMs, clampMs(start - t.releaseMs));
+
+  t.running = true;
+  {
+    LATENCY_SPAN(taskProbe(static_cast<TaskId>(idx)));
+    t.fn();
+  }
+  t.running = false;
+
+  uint32_t end = millis();
+  t.stats.runCount++;
+  t.stats.lastDurationMs = clampMs(end - start);
+  t.stats.maxDurationMs = max(t.stats.maxDurationMs, t.stats.lastDurationMs);
+
+  bool missed = static_cast<int32_t>(end - (t.releaseMs + t.deadlineMs)) > 0;
+  if (missed)
+    reportOverrun(idx, end);
+  advanceRelease(idx, end);
+}
+
+} // namespace
+
+namespace Scheduler {
+
+void addTask(TaskId id, TaskFunction fn, uint16_t periodMs, uint16_t deadlineMs) {
+  if (id >= TaskId::COUNT || periodMs == 0)
+    return;
+  Task& t = tasks[slotOf(id)];
+  t = Task{};
+  t.fn = fn;
+  t.periodMs = periodMs;
+  t.deadlineMs = deadlineMs == 0 ? periodMs : deadlineMs;
+  t.releaseMs = millis();
+#if LATENCY_PROFILING_ENABLED
+  Latency::setBudget(taskProbe(id), t.deadlineMs * 1000UL);
+#endif
+  SerialPrint(SCHEDULER, "Task registered task=", taskName(id), " periodMs=", periodMs,
+              " deadlineMs=", t.deadlineMs);
+}
+
+void setTaskPeriod(TaskId id, uint16_t periodMs) {
+  if (id >= TaskId::COUNT || periodMs == 0)
+    return;
+  Task& t = tasks[slotOf(id)];
+  if (t.periodMs == periodMs)
+    return;
+  uint32_t pulledIn = millis() + periodMs;
+  if (static_cast<int32_t>(t.releaseMs - pulledIn) > 0)
+    t.releaseMs = pulledIn;
+  t.periodMs = periodMs;
+}
+
+bool isDue(TaskId id) {
+  if (id >= TaskId::COUNT)
+    return false;
+  return isReleased(tasks[slotOf(id)], millis());
+}
+
+void dispatch() {
+  uint8_t served = 0;
+  while (true) {
+    int8_t next = pickNextTask(millis(), served);
+    if (next < 0)
+      return;
+    served |= static_cast<uint8_t>(1U << next);
+    runTask(static_cast<uint8_t>(next));
+  }
+}
+
+TaskStats getStats(TaskId id) {
+  if (id >= TaskId::COUNT)
+    return TaskStats{};
+  return tasks[slotOf(id)].stats;
+}
+
+const __FlashStringHelper* taskName(TaskId id) {
+  switch (id) {
+  case TaskId::PUMPS:   return F("PUMPS");
+  case TaskId::SENSOR:  return F("SENSOR");
+  case TaskId::LEVEL:   return F("LEVEL");
+  case TaskId::DOSING:  return F("DOSING");
+  case TaskId::LIGHTS:  return F("LIGHTS");
+  case TaskId::UI:      return F("UI");
+  case TaskId::PERSIST: return F("PERSIST");
+  case TaskId::CONSOLE: return F("CONSOLE");
+  default:              return F("UNKNOWN");
+  }
+}
+
+} // namespace Scheduler
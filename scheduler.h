@@ -0,0 +1,98 @@
+/**
+ * ============================================================================
+ * SCHEDULER.H - Cooperative Deadline-Driven Task Scheduler
+ * ============================================================================
+ *
+ * Replaces the single delay()-paced loop() with a fixed table of periodic
+ * tasks. Every subsystem registers one task with its own period and relative
+ * deadline; dispatch always picks the released task whose absolute deadline
+ * is nearest (earliest-deadline-first), so a slow LCD refresh is never served
+ * ahead of a pending pump shutoff.
+ *
+ * Scheduling is cooperative: a task body runs to completion and must not
+ * block. Overruns (a task finishing after its deadline, or a release that was
+ * skipped because the task fell a full period behind) are counted per task
+ * and reported over serial.
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+class __FlashStringHelper;
+
+// Task body signature. Must return quickly; never busy-wait inside a task.
+typedef void (*TaskFunction)();
+
+// One slot per subsystem. Order doubles as tie-break priority when two
+// released tasks share the same absolute deadline (lower value wins).
+enum class TaskId : uint8_t {
+  PUMPS = 0,  // Pump engine tick (relay shutoff at deadline)
+  SENSOR,     // I2C water sensor sampling
+  LEVEL,      // Water level control and cleaning schedule
+  DOSING,     // Dosing pump schedule
+  LIGHTS,     // Light schedule / override
+  UI,         // Keypad and LCD
+  PERSIST,    // Deferred EEPROM commits
+  CONSOLE,    // Serial maintenance commands and reports
+  COUNT
+};
+
+constexpr uint8_t TASK_COUNT = static_cast<uint8_t>(TaskId::COUNT);
+
+// Runtime bookkeeping for one task. Times are in ms unless noted.
+struct TaskStats {
+  uint32_t runCount;        // Completed executions
+  uint16_t overrunCount;    // Deadline misses + skipped releases
+  uint16_t lastDurationMs;  // Execution time of the most recent run
+  uint16_t maxDurationMs;   // Worst observed execution time
+  uint16_t maxLatenessMs;   // Worst release-to-start delay
+};
+
+namespace Scheduler {
+
+/**
+ * Register (or re-register) a periodic task.
+ * @param id Task slot
+ * @param fn Task body (nullptr disables the slot)
+ * @param periodMs Release period in ms, > 0
+ * @param deadlineMs Relative deadline in ms, 0 means "equal to period"
+ * Side effects: first release is immediate; statistics are cleared.
+ */
+void addTask(TaskId id, TaskFunction fn, uint16_t periodMs, uint16_t deadlineMs);
+
+/**
+ * Change the period of a registered task without resetting its statistics.
+ * The next release is pulled in if the new period is shorter.
+ * @param periodMs New release period in ms, > 0 (0 is ignored)
+ */
+void setTaskPeriod(TaskId id, uint16_t periodMs);
+
+/**
+ * @return true when a task's release is pending and it is not running, i.e.
+ *         it would be picked by the next dispatch() round
+ */
+bool isDue(TaskId id);
+
+/**
+ * Run every released task once, earliest absolute deadline first.
+ * Call from loop(). Re-entrant: a task that calls dispatch() (legacy blocking
+ * screens) gets the other tasks serviced while it is itself skipped.
+ */
+void dispatch();
+
+/**
+ * Read statistics for one task.
+ * @return Copy of the task's counters (zeroed if never registered)
+ */
+TaskStats getStats(TaskId id);
+
+/**
+ * Printable task name stored in flash (for serial reports).
+ */
+const __FlashStringHelper* taskName(TaskId id);
+
+} // namespace Scheduler
+
+#endif // SCHEDULER_H
@@ -34,6 +34,7 @@ void splashScreen() {
     lcd.write(3);
 
     Glyphs::animateIcon(slots, r, scratch);
+    lcd.flushAll();
     delay(80);
   }
   delay(Hardware::UI_DELAY_MEDIUM_MS);
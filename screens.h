@@ -49,13 +49,6 @@ extern Language LANG_BUFFER;
  */
 void splashScreen();
 
-/**
- * Display language selection screen
- * @param idx Current language index
- * @return Selected language index
- */
-uint8_t langConfigScreen(uint8_t idx);
-
 /**
  * Get elapsed seconds since startup
  * Handles millis() overflow automatically
@@ -77,45 +70,6 @@ inline uint64_t seconds() {
   return totalMillis / Hardware::UI_DELAY_MEDIUM_MS;
 }
 
-/**
- * Display tank volume input screen
- * @param tankVolumeBuf Localized label for tank volume
- * @param editMode Whether to allow editing
- * @param tankVolume Current tank volume value
- * @return Entered tank volume, or -1 if cancelled
- */
-uint32_t tankVolumeScreen(const char *tankVolumeBuf, bool editMode, uint32_t tankVolume);
-
-/**
- * Display pump amount input screen
- * @param amountBuf Localized label for amount
- * @param pumpIndex Which pump (0-4)
- * @param editMode Whether to allow editing
- * @param amount Current amount value
- * @return Entered amount, or -1 if cancelled
- */
-uint16_t pumpAmountScreen(const char *amountBuf, uint8_t pumpIndex, bool editMode, uint16_t amount);
-
-/**
- * Display pump duration input screen
- * @param intervalBuf Localized label for duration
- * @param pumpIndex Which pump (0-4)
- * @param editMode Whether to allow editing
- * @param duration Current interval duration value in milliseconds
- * @return Entered duration, or -1 if cancelled
- */
-uint16_t pumpIntervalScreen(const char *intervalBuf, uint8_t pumpIndex, bool editMode, uint16_t duration);
-
-// Days-based cleaning interval input screen
-uint16_t cleanIntervalScreen(const char *intervalBuf, bool editMode, uint16_t days);
-
-/**
- * Display main/idle screen
- * @param mainScreenBuf Localized main screen label
- * @param NoTaskBuf Localized no task message
- */
-void mainScreen(const char *mainScreenBuf, const char *NoTaskBuf);
-
 /**
  * Print string to LCD with custom glyphs support
  * Replaces certain characters with LCD custom characters
@@ -132,62 +86,107 @@ void lcdPrintWithGlyphs(const char *str, uint8_t length, uint8_t col, uint8_t ro
  */
 void showTime(uint64_t currentTime);
 
-/**
- * Display time setup screen for setting current time
- * @return Time offset from millis(), or -1 if cancelled
- */
-uint64_t timeSetupScreen(const char *label = "");
-
-/**
- * Display water threshold configuration screen
- * @param thresholdBuf Localized label for threshold
- * @param editMode Whether to allow editing
- * @param lowThreshold Current low threshold value
- * @param highThreshold Current high threshold value
- * @return 1 if modified, 0 if not modified, -1 if cancelled
- */
-uint8_t waterThresholdScreen(const char *thresholdBuf, bool editMode, int16_t lowThreshold, int16_t highThreshold);
-
-/**
- * Handle editing pump amount (view + optional edit on followup key)
- * @param idx Pump index (0-4)
- */
-void handleEditAmount(uint8_t idx);
-
-/**
- * Handle editing tank volume (view + optional edit on followup key)
- */
-void handleEditTankVolume(const char *tankTitle);
-
-// /**
-//  * Handle editing pump duration
-//  * @param idx Pump index (0-4)
-//  */
-// void handleEditPumpDuration(uint8_t idx);
-
-/**
- * Display a numeric input screen
- * @param label Title displayed on first line
- * @param format Format string with placeholder "_" for digits (PROGMEM)
- * @param entryCol Column where digit entry starts (LCD column 0-15)
- * @param maxDigits Maximum number of digits allowed
- * @param value Initial/current value
- * @param editMode If true, allows editing; if false, shows value only
- * @param unit Optional unit label (e.g., "ml", "l") displayed after digits
- * @return Entered value, or -1 if cancelled
- */
-uint32_t editNumberScreen(const char *label, const char *format, uint8_t entryCol, uint8_t maxDigits, uint32_t value, bool editMode, const char *unit = nullptr);
-
-
-/*
-  * Handle editing water thresholds (view + optional edit on followup key)
-  * User edits Inlet and Outlet thresholds sequentially.
-  * If user enters invalid values, calls police.
-*/
-void handleThreshold();
-
-void lightTimeScreen(uint64_t *lightofftime, uint64_t *lightontime);
-
-
+// ============================================================================
+// Non-blocking screens
+// ============================================================================
+//
+// Every interactive screen is an object with begin() (draws it) and
+// update(key) (consumes at most one key event, 0 = none). update() never
+// waits; UIStateController calls it once per UI tick until it reports DONE
+// or CANCELLED.
+
+// Outcome of one update() call
+enum class ScreenResult : uint8_t {
+  ACTIVE,    // Still waiting for input
+  DONE,      // Confirmed; read value()
+  CANCELLED  // Left with '*' (or too many digits)
+};
+
+// Layout of a numeric input field
+struct NumberFieldSpec {
+  const char *label;   // Title on line 0 (UTF-8, glyphs allowed)
+  const char *format;  // Line 1 template, '_' marks digit cells
+  const char *unit;    // Unit drawn after the digits, nullptr = none
+  uint8_t entryCol;    // First digit column (0-15)
+  uint8_t maxDigits;   // Digit cells available
+  char labelDigit;     // Replaces the first '#' in label (pump number), 0 = none
+};
+
+NumberFieldSpec tankVolumeField();
+NumberFieldSpec lowThresholdField();
+NumberFieldSpec highThresholdField();
+NumberFieldSpec cleanIntervalField();
+NumberFieldSpec pumpAmountField(uint8_t pumpIndex);
+NumberFieldSpec pumpIntervalField(uint8_t pumpIndex);
+
+// Numeric input with blinking cursor. View mode shows the value and
+// switches to editing on '#'; in edit mode digits append, '*' clears (or
+// cancels when already empty) and '#' confirms.
+class NumberEditor {
+public:
+  /**
+   * Draw the field.
+   * @param value Initial value; UNSET_U32 starts with no digits
+   * @param editMode false = view mode until '#'
+   */
+  void begin(const NumberFieldSpec &spec, uint32_t value, bool editMode);
+  ScreenResult update(char key);
+  uint32_t value() const { return number; }
+
+private:
+  ScreenResult handleViewKey(char key);
+  ScreenResult handleEditKey(char key);
+  void redraw();
+  void blink();
+
+  char label[LANG_AMOUNTTITLE_LEN + 1];
+  NumberFieldSpec spec;
+  uint32_t number;
+  uint32_t lastBlinkMs;
+  uint8_t curLen;
+  uint8_t lastDigitPos;
+  char lastDigitChar;
+  bool editing;
+  bool digitsEntered;
+  bool showCursor;
+};
+
+// HH:MM:SS entry. Digits overwrite the cursor cell and advance it, A/B move
+// the cursor, '#' confirms, '*' cancels.
+class TimeEditor {
+public:
+  /**
+   * Draw the editor.
+   * @param label Short caption next to the time (max 8 cells)
+   * @param secondsOfDay Initial time, 0-86399
+   */
+  void begin(const char *label, uint32_t secondsOfDay);
+  ScreenResult update(char key);
+  // Confirmed time in seconds since midnight (fields wrapped into range)
+  uint32_t value() const;
+
+private:
+  void drawDigits();
+
+  char digits[6];
+  uint32_t lastBlinkMs;
+  uint8_t pos;
+  bool showCursor;
+};
+
+// Language selection: digits pick an index, A/B step through the list,
+// '#' confirms, '*' keeps the initial language.
+class LanguagePicker {
+public:
+  void begin(uint8_t languageIndex);
+  ScreenResult update(char key);
+  uint8_t value() const { return selected; }
+
+private:
+  void draw();
+
+  uint8_t initial;
+  uint8_t selected;
+};
 
 #endif
@@ -11,175 +11,133 @@
 #include "debug.hpp"
 #include <Arduino.h>
 
-/**
- * Generic numeric input screen with real-time editing
- * Handles cursor blinking, multi-digit number entry, and validation
- */
-uint32_t editNumberScreen(const char *label, const char *format, uint8_t entryCol, uint8_t maxDigits, uint32_t value, bool editMode, const char *unit) {
-  SerialPrint(KEYPAD_INPUT, "Opening numeric editor label=", label, " maxDigits=", maxDigits, " initialValue=", value);
+// Cursor blink half-period
+static constexpr uint16_t CURSOR_BLINK_MS = 500;
+
+// Writes `v` in decimal to `out` (no terminator needed by callers beyond the
+// returned length; one is written anyway). Returns the number of digits.
+static uint8_t formatDecimal(uint32_t v, char *out) {
+  char rev[10];
+  uint8_t n = 0;
+  do {
+    rev[n++] = '0' + (v % 10);
+    v /= 10;
+  } while (v > 0);
+  for (uint8_t i = 0; i < n; i++)
+    out[i] = rev[n - 1 - i];
+  out[n] = '\0';
+  return n;
+}
+
+void NumberEditor::begin(const NumberFieldSpec &fieldSpec, uint32_t value, bool editMode) {
+  spec = fieldSpec;
+  strncpy(label, spec.label, sizeof(label) - 1);
+  label[sizeof(label) - 1] = '\0';
+  char *hash = strchr(label, '#');
+  if (spec.labelDigit != 0 && hash != nullptr)
+    *hash = spec.labelDigit;
+  SerialPrint(KEYPAD_INPUT, "Opening numeric editor label=", label, " maxDigits=", spec.maxDigits,
+              " initialValue=", value);
+
+  number = value;
+  digitsEntered = (value != UNSET_U32);
+  editing = editMode;
+  showCursor = false;
+  lastBlinkMs = millis();
+
   lcd.clear();
   lcdPrintWithGlyphs(label, 16, 0, 0);
-  lcd.setCursor(0, 1);
-
-  // Copy format into a local RAM buffer so we can inspect characters
-  char fmtBuf[17];
-  strncpy(fmtBuf, format, 16);
-  fmtBuf[16] = '\0';
-  lcdPrintWithGlyphs(fmtBuf, 16, 0, 1);
+  lcdPrintWithGlyphs(spec.format, 16, 0, 1);
+  redraw();
+}
 
-  // Determine whether the format already contains a unit character
-  bool formatHasUnit = false;
-  uint8_t unitPos = entryCol + maxDigits;
-  if (unit && unitPos < sizeof(fmtBuf) - 1 && fmtBuf[unitPos] != '\0' && fmtBuf[unitPos] != ' ' && fmtBuf[unitPos] != '_') {
-    formatHasUnit = true;
+// Redraws the digit cells right-aligned and records where the blinking
+// cursor sits (on the last digit).
+void NumberEditor::redraw() {
+  lcd.setCursor(spec.entryCol, 1);
+  for (uint8_t i = 0; i < spec.maxDigits; i++)
+    lcd.print('_');
+
+  curLen = 0;
+  lastDigitPos = spec.entryCol + spec.maxDigits - 1;
+  lastDigitChar = ' ';
+  if (digitsEntered) {
+    char tmp[11];
+    uint8_t len = formatDecimal(number, tmp);
+    const char *shown = len > spec.maxDigits ? tmp + (len - spec.maxDigits) : tmp;
+    curLen = len > spec.maxDigits ? spec.maxDigits : len;
+    lcd.setCursor(spec.entryCol + spec.maxDigits - curLen, 1);
+    lcd.print(shown);
+    lastDigitChar = shown[curLen - 1];
   }
 
-  // Animation timing for cursor blink (500ms period)
-  unsigned long lastBlink = millis();
-  bool showCursor = false;
-  bool digitsEntered = (value != UNSET_U32);
-  uint8_t lastDigitPos = entryCol + maxDigits - 1;
-  char lastDigitChar = ' ';
-  uint8_t curLen = 0;
-
-  /**
-   * Lambda function to redraw the numeric input field
-   */
-  auto redrawNumber = [&](uint32_t val) {
-    lcd.setCursor(entryCol, 1);
-    for (uint8_t i = 0; i < maxDigits; i++)
-      lcd.print('_');
-
-    if (!digitsEntered) {
-      curLen = 0;
-      lastDigitPos = entryCol + maxDigits - 1;
-      lastDigitChar = ' ';
-      if (unit && !formatHasUnit) {
-        lcd.setCursor(unitPos, 1);
-        lcd.print(unit);
-      }
-      return;
-    }
-
-    char tmp[12]; // Increased size for safety (uint32 can be 10 digits)
-    uint8_t idx = 0;
-    unsigned long v = static_cast<unsigned long>(val);
-
-    if (v == 0) {
-      tmp[idx++] = '0';
-    } else {
-      char rev[12];
-      uint8_t ri = 0;
-      while (v > 0 && ri < sizeof(rev)) {
-        rev[ri++] = '0' + (v % 10);
-        v /= 10;
-      }
-      for (int8_t i = ri - 1; i >= 0; --i)
-        tmp[idx++] = rev[i];
-    }
-    tmp[idx] = '\0';
-
-    if (idx > maxDigits) {
-      const char *p = tmp + (idx - maxDigits);
-      lcd.setCursor(entryCol, 1);
-      lcd.print(p);
-      curLen = maxDigits;
-      lastDigitPos = entryCol + maxDigits - 1;
-      lastDigitChar = p[maxDigits - 1];
-    } else {
-      uint8_t start = entryCol + (maxDigits - idx);
-      lcd.setCursor(start, 1);
-      lcd.print(tmp);
-      curLen = idx;
-      if (curLen == 0) {
-        lastDigitPos = entryCol + maxDigits - 1;
-        lastDigitChar = ' ';
-      } else {
-        lastDigitPos = start + curLen - 1;
-        lastDigitChar = tmp[curLen - 1];
-      }
-    }
-
-    if (unit && !formatHasUnit) {
-      lcd.setCursor(unitPos, 1);
-      lcd.print(unit);
-    }
-  };
-
-  redrawNumber(value);
-  bool localEdit = editMode;
-  uint32_t number = value;
-
-  while (true) {
-    // RUN BACKGROUND TASKS
-    extern void handleWaterMonitoring(bool);
-    handleWaterMonitoring(false);
-
-    char key = keypad.getKey();
-
-    if (localEdit && millis() - lastBlink >= 500) {
-      lastBlink = millis();
-      showCursor = !showCursor;
-      lcd.setCursor(lastDigitPos, 1);
-      if (showCursor)
-        lcd.print('|');
-      else
-        lcd.print(lastDigitChar);
-    }
+  // Formats that already print the unit keep theirs
+  uint8_t unitPos = spec.entryCol + spec.maxDigits;
+  char formatAtUnit = unitPos < strlen(spec.format) ? spec.format[unitPos] : ' ';
+  if (spec.unit != nullptr && (formatAtUnit == ' ' || formatAtUnit == '_')) {
+    lcd.setCursor(unitPos, 1);
+    lcd.print(spec.unit);
+  }
+}
 
-    if (!key) {
-      delay(10);
-      continue;
-    }
+void NumberEditor::blink() {
+  if (!editing || millis() - lastBlinkMs < CURSOR_BLINK_MS)
+    return;
+  lastBlinkMs = millis();
+  showCursor = !showCursor;
+  lcd.setCursor(lastDigitPos, 1);
+  lcd.print(showCursor ? '|' : lastDigitChar);
+}
 
-    if (!localEdit) {
-      if (key == '#') {
-        SerialPrint(KEYPAD_INPUT, "Numeric editor entering edit mode");
-        localEdit = true;
-        if (number != UNSET_U32)
-          digitsEntered = true;
-        else {
-          digitsEntered = false;
-          number = 0;
-        }
-        redrawNumber(number);
-      } else if (key == '*') {
-        SerialPrint(KEYPAD_INPUT, "Numeric editor cancelled before editing");
-        return UNSET_U32;
-      }
-      continue;
-    }
+ScreenResult NumberEditor::update(char key) {
+  blink();
+  if (!key)
+    return ScreenResult::ACTIVE;
+  return editing ? handleEditKey(key) : handleViewKey(key);
+}
 
-    if (key == '*') {
-      SerialPrint(KEYPAD_INPUT, "Numeric editor clear/cancel key pressed");
-      if (!digitsEntered)
-        return UNSET_U32;
+ScreenResult NumberEditor::handleViewKey(char key) {
+  if (key == '*') {
+    SerialPrint(KEYPAD_INPUT, "Numeric editor cancelled before editing");
+    return ScreenResult::CANCELLED;
+  }
+  if (key == '#') {
+    SerialPrint(KEYPAD_INPUT, "Numeric editor entering edit mode");
+    editing = true;
+    digitsEntered = (number != UNSET_U32);
+    if (!digitsEntered)
       number = 0;
-      digitsEntered = false;
-      redrawNumber(number);
-      continue;
-    }
+    redraw();
+  }
+  return ScreenResult::ACTIVE;
+}
 
-    if (key == '#') {
-      SerialPrint(KEYPAD_INPUT, "Numeric editor confirm key pressed");
-      if (!digitsEntered)
-        return UNSET_U32;
-      SerialPrint(KEYPAD_INPUT, "Numeric editor returning value=", number);
-      return number;
-    }
+ScreenResult NumberEditor::handleEditKey(char key) {
+  if (key == '*') {
+    SerialPrint(KEYPAD_INPUT, "Numeric editor clear/cancel key pressed");
+    if (!digitsEntered)
+      return ScreenResult::CANCELLED;
+    number = 0;
+    digitsEntered = false;
+    redraw();
+    return ScreenResult::ACTIVE;
+  }
+  if (key == '#') {
+    SerialPrint(KEYPAD_INPUT, "Numeric editor confirm key pressed value=", number);
+    return digitsEntered ? ScreenResult::DONE : ScreenResult::CANCELLED;
+  }
+  if (key < '0' || key > '9')
+    return ScreenResult::ACTIVE;
 
-    if (key >= '0' && key <= '9') {
-      SerialPrint(KEYPAD_INPUT, "Numeric digit entered: ", key);
-      if (number == UNSET_U32) number = 0;
-      if (curLen < maxDigits) {
-        digitsEntered = true;
-        number = number * 10 + (key - '0');
-        redrawNumber(number);
-      } else {
-        SerialPrint(KEYPAD_INPUT, "Numeric editor overflow: too many digits; returning UNSET");
-        return UNSET_U32;
-      }
-      continue;
-    }
+  SerialPrint(KEYPAD_INPUT, "Numeric digit entered: ", key);
+  if (curLen >= spec.maxDigits) {
+    SerialPrint(KEYPAD_INPUT, "Numeric editor overflow: too many digits; cancelling");
+    return ScreenResult::CANCELLED;
   }
+  if (!digitsEntered || number == UNSET_U32)
+    number = 0;
+  digitsEntered = true;
+  number = number * 10 + (key - '0');
+  redraw();
+  return ScreenResult::ACTIVE;
 }
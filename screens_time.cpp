@@ -10,109 +10,79 @@
 #include "debug.hpp"
 #include <Arduino.h>
 
-uint64_t timeSetupScreen(const char *label) {
-  uint64_t nowSecs = seconds();
-  SerialPrint(TIME, "Opening time setup screen for label=", label);
-  uint32_t tod = static_cast<uint32_t>(nowSecs % 86400ULL);
-  uint8_t hh = tod / 3600;
-  uint8_t mm = (tod % 3600) / 60;
-  uint8_t ss = tod % 60;
-
-  auto showTimeFunc = [&](const char digits[6]) {
-    lcd.clear();
-    lcd.setCursor(0, 0);
-    lcd.print(digits[0]);
-    lcd.print(digits[1]);
-    lcd.print(':');
-    lcd.print(digits[2]);
-    lcd.print(digits[3]);
-    lcd.print(':');
-    lcd.print(digits[4]);
-    lcd.print(digits[5]);
-    lcd.print(" ");
-    lcdPrintWithGlyphs(label, 8, 9, 0); // Assuming rest of line
-    lcd.setCursor(0, 1);
-    lcd.print("#=OK  *=Cancel");
-  };
-
-  char digits[7];
-  digits[0] = '0' + (hh / 10);
-  digits[1] = '0' + (hh % 10);
-  digits[2] = '0' + (mm / 10);
-  digits[3] = '0' + (mm % 10);
-  digits[4] = '0' + (ss / 10);
-  digits[5] = '0' + (ss % 10);
-  digits[6] = '\0';
+// Cursor blink half-period
+static constexpr uint16_t CURSOR_BLINK_MS = 500;
 
-  showTimeFunc(digits);
+// LCD column of digit cell i in "HH:MM:SS"
+static uint8_t digitColumn(uint8_t i) { return i + i / 2; }
 
-  uint8_t pos = 0;
-  unsigned long lastBlink = millis();
-  bool showCursor = true;
-
-  while (true) {
-    extern void handleWaterMonitoring(bool);
-    handleWaterMonitoring(false);
+void TimeEditor::begin(const char *label, uint32_t secondsOfDay) {
+  SerialPrint(TIME, "Opening time setup screen for label=", label);
+  uint8_t fields[3] = { static_cast<uint8_t>(secondsOfDay / 3600),
+                        static_cast<uint8_t>((secondsOfDay % 3600) / 60),
+                        static_cast<uint8_t>(secondsOfDay % 60) };
+  for (uint8_t i = 0; i < 3; i++) {
+    digits[2 * i] = '0' + fields[i] / 10;
+    digits[2 * i + 1] = '0' + fields[i] % 10;
+  }
+  pos = 0;
+  showCursor = true;
+  lastBlinkMs = millis();
 
-    for (uint8_t i = 0; i < 6; ++i) {
-      uint8_t col = (i < 2) ? i : ((i < 4) ? (i + 1) : (i + 2));
-      lcd.setCursor(col, 0);
-      if (i == pos && showCursor) {
-        lcd.print('|');
-      } else {
-        lcd.print(digits[i]);
-      }
-    }
+  lcd.clear();
+  lcd.setCursor(2, 0);
+  lcd.print(':');
+  lcd.setCursor(5, 0);
+  lcd.print(':');
+  lcdPrintWithGlyphs(label, 8, 9, 0);
+  lcd.setCursor(0, 1);
+  lcd.print("#=OK  *=Cancel");
+  drawDigits();
+}
 
-    if (millis() - lastBlink >= 500) {
-      lastBlink = millis();
-      showCursor = !showCursor;
-    }
+void TimeEditor::drawDigits() {
+  for (uint8_t i = 0; i < 6; ++i) {
+    lcd.setCursor(digitColumn(i), 0);
+    lcd.print(i == pos && showCursor ? '|' : digits[i]);
+  }
+}
 
-    char key = keypad.getKey();
-    if (!key) {
-      delay(10);
-      continue;
-    }
+ScreenResult TimeEditor::update(char key) {
+  bool dirty = false;
+  if (millis() - lastBlinkMs >= CURSOR_BLINK_MS) {
+    lastBlinkMs = millis();
+    showCursor = !showCursor;
+    dirty = true;
+  }
 
-    if (key >= '0' && key <= '9') {
-      SerialPrint(KEYPAD_INPUT, "Time digit entered at pos ", pos, ": ", key);
-      digits[pos] = key;
-      pos = (pos + 1) % 6;
-      showCursor = true;
-      continue;
-    }
+  if (key >= '0' && key <= '9') {
+    SerialPrint(KEYPAD_INPUT, "Time digit entered at pos ", pos, ": ", key);
+    digits[pos] = key;
+    pos = (pos + 1) % 6;
+    showCursor = true;
+    dirty = true;
+  } else if (key == 'A' || key == 'B') {
+    SerialPrint(KEYPAD_INPUT, "Time cursor moved ", key == 'A' ? "right" : "left");
+    pos = key == 'A' ? (pos + 1) % 6 : (pos + 5) % 6;
+    dirty = true;
+  } else if (key == '*') {
+    SerialPrint(TIME, "Time setup cancelled by user");
+    return ScreenResult::CANCELLED;
+  } else if (key == '#') {
+    SerialPrint(TIME, "Time setup confirmed secondsOfDay=", value());
+    return ScreenResult::DONE;
+  }
 
-    if (key == 'A') {
-      SerialPrint(KEYPAD_INPUT, "Time cursor moved right to next position");
-      pos = (pos + 1) % 6;
-      continue;
-    }
-    if (key == 'B') {
-      SerialPrint(KEYPAD_INPUT, "Time cursor moved left to previous position");
-      pos = (pos + 6 - 1) % 6;
-      continue;
-    }
-    if (key == '*') {
-      SerialPrint(TIME, "Time setup cancelled by user");
-      return UNSET_U64;
-    }
-    if (key == '#') {
-      uint8_t nh = (digits[0] - '0') * 10 + (digits[1] - '0');
-      uint8_t nm = (digits[2] - '0') * 10 + (digits[3] - '0');
-      uint8_t ns = (digits[4] - '0') * 10 + (digits[5] - '0');
-      if (nh > 23) nh = nh % 24;
-      if (nm > 59) nm = nm % 60;
-      if (ns > 59) ns = ns % 60;
+  if (dirty)
+    drawDigits();
+  return ScreenResult::ACTIVE;
+}
 
-      uint32_t enteredSeconds = static_cast<uint32_t>(nh) * 3600UL +
-                                static_cast<uint32_t>(nm) * 60UL +
-                                static_cast<uint32_t>(ns);
-      uint64_t tmptimeoffset = seconds() - static_cast<uint64_t>(enteredSeconds);
-      SerialPrint(TIME, "Time setup confirmed: hh=", nh, " mm=", nm, " ss=", ns, " -> enteredSeconds=", enteredSeconds);
-      return (seconds() - tmptimeoffset);
-    }
-  }
+uint32_t TimeEditor::value() const {
+  uint8_t hh = ((digits[0] - '0') * 10 + (digits[1] - '0')) % 24;
+  uint8_t mm = ((digits[2] - '0') * 10 + (digits[3] - '0')) % 60;
+  uint8_t ss = ((digits[4] - '0') * 10 + (digits[5] - '0')) % 60;
+  return static_cast<uint32_t>(hh) * 3600UL + static_cast<uint32_t>(mm) * 60UL + ss;
 }
 
 void showTime(uint64_t currentTime) {
@@ -134,11 +104,3 @@ void showTime(uint64_t currentTime) {
   if (ss < 10) lcd.print('0');
   lcd.print(ss);
 }
-
-void lightTimeScreen(uint64_t *lightofftime, uint64_t *lightontime) {
-  SerialPrint(LIGHTS, "Opening light schedule setup screens");
-  lcd.clear();
-  *lightofftime = timeSetupScreen("LightOFF");
-  *lightontime = timeSetupScreen("LightON");
-  SerialPrint(LIGHTS, "Light schedule captured: off=", static_cast<uint32_t>(*lightofftime), " on=", static_cast<uint32_t>(*lightontime));
-}
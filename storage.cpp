@@ -9,62 +9,310 @@
  */
 #include "debug.hpp"
 #include "appstate.h"
+#include "dosing_planner.h"
+#include "latency.h"
+#include "pump_flow.h"
 #include "storage.h"
 #include <Arduino.h>
 #include <EEPROM.h>
 #include <stdint.h>
 
-// EEPROM addresses for configuration struct
-#define CONFIG_START_ADDR 0
-#define CONFIG_SIZE sizeof(Configuration)
-
-// Helper function to write bytes to EEPROM
-static void writeEEPROMBytes(uint16_t address, const uint8_t* data, uint16_t size) {
-  SerialPrint(STORAGE, F("Writing "), size, F(" bytes to EEPROM at address "), address);
-  SerialPrint(STORAGE, F("Data: "));
-  for (uint16_t i = 0; i < size; i++) {
-    Serial.print(data[i], HEX);
-    Serial.print(F(" "));
-    EEPROM.write(address + i, data[i]);
+// Deferred commit state: set by requestConfigurationSave(), cleared once
+// the configuration is written
+static bool savePending = false;
+static uint32_t firstRequestMs = 0; // Oldest uncommitted request of the burst
+static uint32_t lastRequestMs = 0;  // Newest request; the quiet period runs from here
+
+// Last configuration written or loaded; commits diff against it
+static Configuration committed;
+
+// ---------------------------------------------------------------------------
+// Two-slot records
+// ---------------------------------------------------------------------------
+
+uint8_t crc8(uint8_t crc, const void* data, uint8_t size) {
+  const uint8_t* bytes = static_cast<const uint8_t*>(data);
+  for (uint8_t i = 0; i < size; i++) {
+    crc ^= bytes[i];
+    for (uint8_t bit = 0; bit < 8; bit++)
+      crc = (crc & 0x80) ? static_cast<uint8_t>((crc << 1) ^ 0x07) : static_cast<uint8_t>(crc << 1);
   }
-  Serial.println();
+  return crc;
 }
 
-// Helper function to read bytes from EEPROM
-static void readEEPROMBytes(uint16_t address, uint8_t* data, uint16_t size) {
-  SerialPrint(STORAGE, F("Reading "), size, F(" bytes from EEPROM at address "), address);
-  SerialPrint(STORAGE, F("Data: "));
-  for (uint16_t i = 0; i < size; i++) {
-    data[i] = EEPROM.read(address + i);
-    Serial.print(data[i], HEX);
-    Serial.print(F(" "));
+// CRC-8 over the sequence byte and the payload.
+static uint8_t recordCrc(uint8_t seq, const uint8_t* data, uint8_t size) {
+  return crc8(crc8(0, &seq, 1), data, size);
+}
+
+// Reads slot `slot` into `data`; returns true if its CRC matches.
+static bool readSlot(uint16_t address, uint8_t slot, uint8_t* data, uint8_t size, uint8_t* seq) {
+  uint16_t base = address + slot * (size + 2U);
+  *seq = EEPROM.read(base);
+  for (uint8_t i = 0; i < size; i++)
+    data[i] = EEPROM.read(base + 1 + i);
+  return EEPROM.read(base + 1 + size) == recordCrc(*seq, data, size);
+}
+
+// Index of the slot holding the newest valid copy (its sequence number in
+// *seq), or -1 if neither slot is intact.
+static int8_t newestSlot(uint16_t address, uint8_t* scratch, uint8_t size, uint8_t* seq) {
+  uint8_t seqs[2];
+  bool valid[2];
+  for (uint8_t s = 0; s < 2; s++)
+    valid[s] = readSlot(address, s, scratch, size, &seqs[s]);
+  int8_t newest = -1;
+  if (valid[0] && valid[1])
+    newest = static_cast<int8_t>(seqs[1] - seqs[0]) > 0 ? 1 : 0;
+  else if (valid[0] || valid[1])
+    newest = valid[0] ? 0 : 1;
+  if (newest >= 0)
+    *seq = seqs[newest];
+  return newest;
+}
+
+// Writes one slot. The CRC byte is invalidated first so a write torn by a
+// reset can never leave a slot that passes the check with mixed contents.
+static void writeSlot(uint16_t address, uint8_t slot, const uint8_t* data, uint8_t size,
+                      uint8_t seq) {
+  uint16_t base = address + slot * (size + 2U);
+  uint8_t crc = recordCrc(seq, data, size);
+  EEPROM.update(base + 1 + size, static_cast<uint8_t>(~crc));
+  EEPROM.update(base, seq);
+  for (uint8_t i = 0; i < size; i++)
+    EEPROM.update(base + 1 + i, data[i]);
+  EEPROM.update(base + 1 + size, crc);
+}
+
+void storeRecord(uint16_t address, const void* payload, uint8_t size) {
+  uint8_t scratch[RECORD_MAX_PAYLOAD];
+  if (size > sizeof(scratch))
+    return;
+  uint8_t seq = 0;
+  int8_t newest = newestSlot(address, scratch, size, &seq);
+  uint8_t slot = newest == 0 ? 1 : 0;
+  writeSlot(address, slot, static_cast<const uint8_t*>(payload), size,
+            static_cast<uint8_t>(seq + 1));
+}
+
+bool loadRecord(uint16_t address, void* payload, uint8_t size) {
+  uint8_t scratch[RECORD_MAX_PAYLOAD];
+  if (size > sizeof(scratch))
+    return false;
+  uint8_t seq;
+  int8_t newest = newestSlot(address, scratch, size, &seq);
+  if (newest < 0)
+    return false;
+  readSlot(address, newest, static_cast<uint8_t*>(payload), size, &seq);
+  return true;
+}
+
+void eraseRecord(uint16_t address, uint8_t size) {
+  uint8_t blank[RECORD_MAX_PAYLOAD];
+  if (size > sizeof(blank))
+    return;
+  memset(blank, 0xFF, size);
+  // Blank slots carry a deliberately wrong CRC so they never load
+  uint8_t badCrc = static_cast<uint8_t>(~recordCrc(0xFF, blank, size));
+  for (uint8_t slot = 0; slot < 2; slot++) {
+    uint16_t base = address + slot * (size + 2U);
+    EEPROM.update(base + 1 + size, badCrc);
+    for (uint8_t i = 0; i < size + 1U; i++)
+      EEPROM.update(base + i, 0xFF);
+  }
+}
+
+// ---------------------------------------------------------------------------
+// Configuration
+// ---------------------------------------------------------------------------
+
+// Journal slot: header, payload, CRC-8 over both. `format` names the
+// payload layout so a later layout can still read (and migrate) old records.
+struct JournalHeader {
+  uint8_t format;
+  uint16_t sequence; // Newest record = highest, wrap-aware
+  uint8_t length;    // Payload bytes
+};
+
+// Configuration layout of format 1 and of the pre-journal raw struct:
+// natural alignment, 64-bit times. Read only, for migration.
+struct ConfigurationV1 {
+  uint8_t languageIndex;
+  uint32_t tankVolume;
+  int64_t timeOffset;
+  uint16_t pumpAmounts[Hardware::PUMP_COUNT];
+  uint64_t pumpDurations[Hardware::PUMP_COUNT];
+  uint16_t pumpDosingIntervals[Hardware::PUMP_COUNT];
+  uint16_t lowThreshold;
+  uint16_t highThreshold;
+  uint16_t waterCleaningIntervalDays;
+  uint64_t lastCleaningTime;
+  uint64_t lightOffTime;
+  uint64_t lightOnTime;
+};
+
+// Payload layout and slot geometry of one journal format
+struct JournalFormat {
+  uint8_t id;
+  uint8_t length;   // Payload bytes
+  uint8_t slotSize;
+  uint8_t slots;
+};
+
+static constexpr JournalFormat CONFIG_FORMAT_V1 = {1, sizeof(ConfigurationV1), 128, 16};
+static constexpr JournalFormat CONFIG_FORMAT_V2 = {2, sizeof(Configuration), CONFIG_JOURNAL_SLOT_SIZE,
+                                                   CONFIG_JOURNAL_SLOTS};
+static constexpr uint16_t LEGACY_CONFIG_ADDR = 0x000; // Raw struct of pre-journal firmware
+
+static_assert(sizeof(JournalHeader) + sizeof(ConfigurationV1) + 1 <= 128,
+              "format 1 configuration does not fit its journal slot");
+static_assert(sizeof(JournalHeader) + sizeof(Configuration) + 1 <= CONFIG_JOURNAL_SLOT_SIZE,
+              "configuration does not fit a journal slot");
+
+// Slot of the next save and its sequence number; valid once scanned
+static bool journalScanned = false;
+static uint8_t journalNextSlot = 0;
+static uint16_t journalNextSequence = 0;
+
+static uint16_t journalSlotAddress(const JournalFormat& format, uint8_t slot) {
+  return EepromMap::CONFIG_JOURNAL_ADDR + slot * static_cast<uint16_t>(format.slotSize);
+}
+
+// Reads a slot's header and checks its CRC without copying the payload.
+static bool readJournalHeader(const JournalFormat& format, uint8_t slot, JournalHeader* header) {
+  uint16_t address = journalSlotAddress(format, slot);
+  EEPROM.get(address, *header);
+  if (header->format != format.id || header->length != format.length)
+    return false;
+  uint8_t crc = crc8(0, header, sizeof(*header));
+  uint16_t payload = address + sizeof(*header);
+  for (uint8_t i = 0; i < header->length; i++) {
+    uint8_t b = EEPROM.read(payload + i);
+    crc = crc8(crc, &b, 1);
   }
-  Serial.println();
+  return EEPROM.read(payload + header->length) == crc;
+}
+
+// Newest intact slot of one format, or -1.
+static int8_t scanJournal(const JournalFormat& format, uint16_t* newestSequence) {
+  int8_t newest = -1;
+  JournalHeader header;
+  for (uint8_t slot = 0; slot < format.slots; slot++) {
+    if (!readJournalHeader(format, slot, &header))
+      continue;
+    if (newest < 0 || static_cast<int16_t>(header.sequence - *newestSequence) > 0) {
+      newest = static_cast<int8_t>(slot);
+      *newestSequence = header.sequence;
+    }
+  }
+  return newest;
+}
+
+// Positions the next save after the newest current-format record.
+static int8_t locateJournal() {
+  uint16_t sequence = 0;
+  int8_t newest = scanJournal(CONFIG_FORMAT_V2, &sequence);
+  journalScanned = true;
+  if (newest >= 0) {
+    journalNextSlot = static_cast<uint8_t>((newest + 1) % CONFIG_JOURNAL_SLOTS);
+    journalNextSequence = static_cast<uint16_t>(sequence + 1);
+  }
+  return newest;
+}
+
+// The CRC byte is invalidated first so a torn write never passes the check.
+static void writeJournalSlot(uint8_t slot, const JournalHeader& header, const void* payload) {
+  uint16_t address = journalSlotAddress(CONFIG_FORMAT_V2, slot);
+  uint8_t crc = crc8(crc8(0, &header, sizeof(header)), payload, header.length);
+  uint16_t crcAddress = address + sizeof(header) + header.length;
+  EEPROM.update(crcAddress, static_cast<uint8_t>(~crc));
+  const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&header);
+  for (uint8_t i = 0; i < sizeof(header); i++)
+    EEPROM.update(address + i, bytes[i]);
+  bytes = static_cast<const uint8_t*>(payload);
+  for (uint8_t i = 0; i < header.length; i++)
+    EEPROM.update(address + sizeof(header) + i, bytes[i]);
+  EEPROM.update(crcAddress, crc);
 }
 
 void saveConfiguration(const Configuration& config) {
-  SerialPrint(STORAGE, F("Saving configuration to EEPROM"));
+  if (!journalScanned)
+    locateJournal();
+  JournalHeader header = {CONFIG_FORMAT_V2.id, journalNextSequence, sizeof(Configuration)};
+  writeJournalSlot(journalNextSlot, header, &config);
+  SerialPrint(STORAGE, F("Configuration saved to journal slot "), journalNextSlot,
+              F(" sequence "), journalNextSequence);
+  journalNextSlot = (journalNextSlot + 1) % CONFIG_JOURNAL_SLOTS;
+  journalNextSequence++;
+}
 
-  // Write the entire configuration struct to EEPROM
-  writeEEPROMBytes(CONFIG_START_ADDR, (const uint8_t*)&config, CONFIG_SIZE);
+// 64-bit times fit 32 bits; the unset marker stays the unset marker.
+static uint32_t narrowTime(uint64_t value) {
+  return value > UNSET_U32 ? UNSET_U32 : static_cast<uint32_t>(value);
+}
 
-  SerialPrint(STORAGE, F("Configuration saved successfully"));
+static void migrateV1(const ConfigurationV1& old, Configuration* config) {
+  config->languageIndex = old.languageIndex;
+  config->tankVolume = old.tankVolume;
+  config->timeOffset = narrowTime(static_cast<uint64_t>(old.timeOffset));
+  config->lowThreshold = old.lowThreshold;
+  config->highThreshold = old.highThreshold;
+  config->waterCleaningIntervalDays = old.waterCleaningIntervalDays;
+  config->lastCleaningTime = narrowTime(old.lastCleaningTime);
+  config->lightOffTime = narrowTime(old.lightOffTime);
+  config->lightOnTime = narrowTime(old.lightOnTime);
+  for (uint8_t i = 0; i < Hardware::PUMP_COUNT; i++) {
+    config->pumpAmounts[i] = old.pumpAmounts[i];
+    config->pumpDurations[i] = narrowTime(old.pumpDurations[i]);
+    config->pumpDosingIntervals[i] = old.pumpDosingIntervals[i];
+  }
 }
 
-Configuration loadConfiguration() {
-  SerialPrint(STORAGE, F("Loading configuration from EEPROM"));
+// Reads the newest format 1 record, else the raw struct. The first format 2
+// record goes to the first slot past it, so a torn save keeps it readable.
+// @return true if a format 1 record was found
+static bool loadOldConfiguration(Configuration* config) {
+  ConfigurationV1 old;
+  uint16_t sequence = 0;
+  int8_t newest = scanJournal(CONFIG_FORMAT_V1, &sequence);
+  uint16_t oldEnd = LEGACY_CONFIG_ADDR + sizeof(old);
+  if (newest >= 0) {
+    uint16_t address = journalSlotAddress(CONFIG_FORMAT_V1, newest);
+    EEPROM.get(address + sizeof(JournalHeader), old);
+    oldEnd = address + CONFIG_FORMAT_V1.slotSize;
+    journalNextSequence = static_cast<uint16_t>(sequence + 1);
+    SerialPrint(STORAGE, F("Migrating format 1 configuration from slot "), newest);
+  } else {
+    EEPROM.get(LEGACY_CONFIG_ADDR, old);
+    SerialPrint(STORAGE, F("No configuration record; migrating the pre-journal layout"));
+  }
+  journalNextSlot = ((oldEnd + CONFIG_JOURNAL_SLOT_SIZE - 1) / CONFIG_JOURNAL_SLOT_SIZE) %
+                    CONFIG_JOURNAL_SLOTS;
+  migrateV1(old, config);
+  return newest >= 0;
+}
 
+Configuration loadConfiguration() {
   Configuration config;
-  readEEPROMBytes(CONFIG_START_ADDR, (uint8_t*)&config, CONFIG_SIZE);
-
-  SerialPrint(STORAGE, F("Configuration loaded successfully"));
+  int8_t newest = locateJournal();
+  if (newest < 0) {
+    // A format 1 record is always migrated, even an unset one (factory
+    // reset): part of the old journal is reused (dose clock ring), so an
+    // older record must never resurface as the newest one
+    bool fromJournal = loadOldConfiguration(&config);
+    if (fromJournal || isConfigurationValid(config))
+      saveConfiguration(config);
+    return config;
+  }
+  EEPROM.get(journalSlotAddress(CONFIG_FORMAT_V2, newest) + sizeof(JournalHeader), config);
+  SerialPrint(STORAGE, F("Configuration loaded from journal slot "), newest);
   return config;
 }
 
 static bool validatePumps(const Configuration& config) {
   for (uint8_t i = 0; i < Hardware::PUMP_COUNT; i++) {
     if (config.pumpAmounts[i] == UNSET_U16 ||
-        config.pumpDurations[i] == UNSET_U64 ||
+        config.pumpDurations[i] == UNSET_U32 ||
         config.pumpDosingIntervals[i] == UNSET_U16) {
       SerialPrint(STORAGE, F("Invalid: Pump "), i, F(" data UNSET"));
       return false;
@@ -88,9 +336,9 @@ bool isConfigurationValid(const Configuration& config) {
 
   if (config.languageIndex == UNSET_U8 ||
       config.tankVolume == UNSET_U32 ||
-      config.timeOffset == UNSET_I64 ||
-      config.lightOffTime == UNSET_U64 ||
-      config.lightOnTime == UNSET_U64) {
+      config.timeOffset == UNSET_U32 ||
+      config.lightOffTime == UNSET_U32 ||
+      config.lightOnTime == UNSET_U32) {
     SerialPrint(STORAGE, F("Invalid: General data UNSET"));
     return false;
   }
@@ -102,104 +350,149 @@ bool isConfigurationValid(const Configuration& config) {
   return true;
 }
 
+static void configurationToAppState(const Configuration& config) {
+  AppState::languageIndex = config.languageIndex;
+  AppState::tankVolume = config.tankVolume;
+  AppState::timeOffset = config.timeOffset;
+  AppState::lowThreshold = config.lowThreshold;
+  AppState::highThreshold = config.highThreshold;
+  AppState::waterCleaningIntervalDays = config.waterCleaningIntervalDays;
+  AppState::lastCleaningTime = config.lastCleaningTime;
+  AppState::lightOffTime = config.lightOffTime;
+  AppState::lightOnTime = config.lightOnTime;
+
+  for (uint8_t i = 0; i < Hardware::PUMP_COUNT; i++) {
+    DosingConfig cfg;
+    cfg.amount = config.pumpAmounts[i];
+    cfg.duration = config.pumpDurations[i];
+    cfg.interval = config.pumpDosingIntervals[i];
+    AppState::pumps[i].setConfig(cfg);
+  }
+}
+
 void loadConfigurationToAppState() {
   SerialPrint(STORAGE, F("Loading configuration to AppState"));
 
   Configuration config = loadConfiguration();
+  committed = config;
 
   // Only apply valid configuration
   if (isConfigurationValid(config)) {
-    AppState::languageIndex = config.languageIndex;
-    AppState::tankVolume = config.tankVolume;
-    AppState::timeOffset = config.timeOffset;
-    AppState::lowThreshold = config.lowThreshold;
-    AppState::highThreshold = config.highThreshold;
-    AppState::waterCleaningIntervalDays = config.waterCleaningIntervalDays;
-    AppState::lastCleaningTime = config.lastCleaningTime;
-    AppState::lightOffTime = config.lightOffTime;
-    AppState::lightOnTime = config.lightOnTime;
-
-    for (uint8_t i = 0; i < Hardware::PUMP_COUNT; i++) {
-      DosingConfig cfg;
-      cfg.amount = config.pumpAmounts[i];
-      cfg.duration = config.pumpDurations[i];
-      cfg.interval = config.pumpDosingIntervals[i];
-      AppState::pumps[i].setConfig(cfg);
-    }
-
+    configurationToAppState(config);
     SerialPrint(STORAGE, F("Configuration applied to AppState"));
   } else {
     SerialPrint(STORAGE, F("Invalid configuration, using defaults"));
-    // Apply default configuration
-    AppState::languageIndex = DEFAULT_CONFIG.languageIndex;
-    AppState::tankVolume = DEFAULT_CONFIG.tankVolume;
-    AppState::timeOffset = DEFAULT_CONFIG.timeOffset;
-    AppState::lowThreshold = DEFAULT_CONFIG.lowThreshold;
-    AppState::highThreshold = DEFAULT_CONFIG.highThreshold;
-    AppState::waterCleaningIntervalDays = DEFAULT_CONFIG.waterCleaningIntervalDays;
-    AppState::lastCleaningTime = DEFAULT_CONFIG.lastCleaningTime;
-    AppState::lightOffTime = DEFAULT_CONFIG.lightOffTime;
-    AppState::lightOnTime = DEFAULT_CONFIG.lightOnTime;
-
-    for (uint8_t i = 0; i < Hardware::PUMP_COUNT; i++) {
-      DosingConfig cfg;
-      cfg.amount = DEFAULT_CONFIG.pumpAmounts[i];
-      cfg.duration = DEFAULT_CONFIG.pumpDurations[i];
-      cfg.interval = DEFAULT_CONFIG.pumpDosingIntervals[i];
-      AppState::pumps[i].setConfig(cfg);
-    }
+    configurationToAppState(DEFAULT_CONFIG);
   }
 }
 
-void saveAppStateToConfiguration() {
-  SerialPrint(STORAGE, F("Saving AppState to configuration"));
+// Groups of Configuration fields, reported by a commit
+enum ConfigField : uint8_t {
+  FIELD_LANGUAGE = 1 << 0,
+  FIELD_TANK = 1 << 1,
+  FIELD_CLOCK = 1 << 2,
+  FIELD_PUMPS = 1 << 3,
+  FIELD_THRESHOLDS = 1 << 4,
+  FIELD_CLEANING = 1 << 5,
+  FIELD_LIGHTS = 1 << 6
+};
+
+static inline bool fieldDiffers(const void* a, const void* b, size_t size) {
+  return memcmp(a, b, size) != 0;
+}
 
-  Configuration config;
+// Field groups that differ between two configurations.
+static uint8_t changedFields(const Configuration& a, const Configuration& b) {
+  uint8_t mask = 0;
+  if (a.languageIndex != b.languageIndex) mask |= FIELD_LANGUAGE;
+  if (a.tankVolume != b.tankVolume) mask |= FIELD_TANK;
+  if (a.timeOffset != b.timeOffset) mask |= FIELD_CLOCK;
+  if (fieldDiffers(a.pumpAmounts, b.pumpAmounts, sizeof(a.pumpAmounts)) ||
+      fieldDiffers(a.pumpDurations, b.pumpDurations, sizeof(a.pumpDurations)) ||
+      fieldDiffers(a.pumpDosingIntervals, b.pumpDosingIntervals, sizeof(a.pumpDosingIntervals)))
+    mask |= FIELD_PUMPS;
+  if (a.lowThreshold != b.lowThreshold || a.highThreshold != b.highThreshold)
+    mask |= FIELD_THRESHOLDS;
+  if (a.waterCleaningIntervalDays != b.waterCleaningIntervalDays ||
+      a.lastCleaningTime != b.lastCleaningTime)
+    mask |= FIELD_CLEANING;
+  if (a.lightOffTime != b.lightOffTime || a.lightOnTime != b.lightOnTime)
+    mask |= FIELD_LIGHTS;
+  return mask;
+}
 
-  config.languageIndex = AppState::languageIndex;
-  config.tankVolume = AppState::tankVolume;
-  config.timeOffset = AppState::timeOffset;
-  config.lowThreshold = AppState::lowThreshold;
-  config.highThreshold = AppState::highThreshold;
-  config.waterCleaningIntervalDays = AppState::waterCleaningIntervalDays;
-  config.lastCleaningTime = AppState::lastCleaningTime;
-  config.lightOffTime = AppState::lightOffTime;
-  config.lightOnTime = AppState::lightOnTime;
+static void appStateToConfiguration(Configuration* config) {
+  config->languageIndex = AppState::languageIndex;
+  config->tankVolume = AppState::tankVolume;
+  config->timeOffset = static_cast<uint32_t>(AppState::timeOffset);
+  config->lowThreshold = AppState::lowThreshold;
+  config->highThreshold = AppState::highThreshold;
+  config->waterCleaningIntervalDays = AppState::waterCleaningIntervalDays;
+  config->lastCleaningTime = static_cast<uint32_t>(AppState::lastCleaningTime);
+  config->lightOffTime = static_cast<uint32_t>(AppState::lightOffTime);
+  config->lightOnTime = static_cast<uint32_t>(AppState::lightOnTime);
 
   for (uint8_t i = 0; i < Hardware::PUMP_COUNT; i++) {
     DosingConfig cfg = AppState::pumps[i].getConfig();
-    config.pumpAmounts[i] = cfg.amount;
-    config.pumpDurations[i] = cfg.duration;
-    config.pumpDosingIntervals[i] = static_cast<uint16_t>(cfg.interval);
+    config->pumpAmounts[i] = cfg.amount;
+    config->pumpDurations[i] = static_cast<uint32_t>(cfg.duration);
+    config->pumpDosingIntervals[i] = static_cast<uint16_t>(cfg.interval);
   }
+}
+
+void saveAppStateToConfiguration() {
+  LATENCY_SPAN(LatencyProbe::CONFIG_SAVE);
+  savePending = false; // A direct save also satisfies any pending request
+
+  Configuration config;
+  appStateToConfiguration(&config);
 
+  uint8_t changed = changedFields(config, committed);
+  if (changed == 0) {
+    SerialPrint(STORAGE, F("Configuration unchanged, nothing written"));
+    return;
+  }
   saveConfiguration(config);
-  SerialPrint(STORAGE, F("AppState saved to configuration"));
+  committed = config;
+  SerialPrint(STORAGE, "AppState saved to configuration, changedFields=", changed);
+}
+
+void requestConfigurationSave() {
+  uint32_t now = millis();
+  if (!savePending)
+    firstRequestMs = now;
+  lastRequestMs = now;
+  savePending = true;
+}
+
+void flushPendingConfiguration() {
+  if (!savePending)
+    return;
+  uint32_t now = millis();
+  if (now - lastRequestMs < Hardware::CONFIG_SAVE_QUIET_MS &&
+      now - firstRequestMs < Hardware::CONFIG_SAVE_MAX_DELAY_MS)
+    return; // Still inside a burst of edits
+  saveAppStateToConfiguration();
 }
 
 void factoryReset() {
   SerialPrint(STORAGE, F("==== FACTORY RESET ====="));
 
-  // Create a configuration with magic values
+  // Create a configuration with magic values: every UNSET_* value is all
+  // ones in its field's width; cleaning starts disabled
   Configuration resetConfig;
-
-  resetConfig.languageIndex = UNSET_U8;
-  resetConfig.tankVolume = UNSET_U32;
-  resetConfig.timeOffset = UNSET_I64;
-  resetConfig.lowThreshold = UNSET_U16;
-  resetConfig.highThreshold = UNSET_U16;
+  memset(&resetConfig, 0xFF, sizeof(resetConfig));
   resetConfig.waterCleaningIntervalDays = 0;
   resetConfig.lastCleaningTime = 0;
-  resetConfig.lightOffTime = UNSET_U64;
-  resetConfig.lightOnTime = UNSET_U64;
-
-  for (uint8_t i = 0; i < Hardware::PUMP_COUNT; i++) {
-    resetConfig.pumpAmounts[i] = UNSET_U16;
-    resetConfig.pumpDurations[i] = UNSET_U64;
-    resetConfig.pumpDosingIntervals[i] = UNSET_U16;
-  }
 
   saveConfiguration(resetConfig);
+  committed = resetConfig;
+  savePending = false; // Edits made before the reset are discarded
+  abortWaterCleaningCycle(); // Drops a pending cleaning checkpoint
+  resetSensorCalibration();
+  resetPumpFlow();
+  resetLetRateModel();
+  resetDosingPlanner();
 
   SerialPrint(STORAGE, F("Factory reset completed - all values set to unset state"));
   SerialPrint(STORAGE, F("===================================="));
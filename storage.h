@@ -15,24 +15,26 @@
 #include "water.h"
 #include "hardware.h"
 
-// Configuration structure that mirrors AppState
+// Configuration structure that mirrors AppState. It is also the payload of
+// journal format 2 as is: packed, so the EEPROM layout does not depend on the
+// compiler, and with every field sized to its range.
 struct Configuration {
   uint8_t languageIndex;
   uint32_t tankVolume;
-  int64_t timeOffset;
+  uint32_t timeOffset;                                 // Seconds, 0..86399
   uint16_t pumpAmounts[Hardware::PUMP_COUNT];
-  uint64_t pumpDurations[Hardware::PUMP_COUNT];
+  uint32_t pumpDurations[Hardware::PUMP_COUNT];        // Milliseconds
   uint16_t pumpDosingIntervals[Hardware::PUMP_COUNT];  // Dosing intervals in days
   uint16_t lowThreshold;
   uint16_t highThreshold;
 
-  // Automatic cleaning interval and last run timestamp
+  // Automatic cleaning interval and last run timestamp (dose clock seconds)
   uint16_t waterCleaningIntervalDays;
-  uint64_t lastCleaningTime;
+  uint32_t lastCleaningTime;
 
-  uint64_t lightOffTime;
-  uint64_t lightOnTime;
-};
+  uint32_t lightOffTime;                               // Seconds since midnight
+  uint32_t lightOnTime;
+} __attribute__((packed));
 
 // Default configuration values
 const Configuration DEFAULT_CONFIG = {
@@ -57,14 +59,82 @@ const uint32_t UNSET_U32 = 0xFFFFFFFF;
 const uint64_t UNSET_U64 = 0xFFFFFFFFFFFFFFFF;
 const int64_t UNSET_I64 = 0xFFFFFFFFFFFFFFFF;
 
+// EEPROM layout (ATmega2560: 4096 bytes)
+namespace EepromMap {
+constexpr uint16_t CONFIG_JOURNAL_ADDR = 0x000;      // Configuration journal slots
+constexpr uint16_t CONFIG_JOURNAL_END = 0x500;       // First byte after the journal
+constexpr uint16_t DOSE_CLOCK_RING_ADDR = 0x500;     // Ring of dose clock checkpoints
+constexpr uint16_t DOSE_CLOCK_RING_END = 0x600;      // First byte after the ring
+constexpr uint16_t FREE_ADDR = 0x600;                // Unused up to DOSE_LEDGER_ADDR
+constexpr uint16_t DOSE_LEDGER_ADDR = 0x800;         // Ring of DoseLedgerEntry
+constexpr uint16_t DOSE_LEDGER_END = 0xC00;          // First byte after the ledger
+constexpr uint16_t CLEANING_CHECKPOINT_ADDR = 0xC00; // Record: CleaningCheckpoint
+constexpr uint16_t SENSOR_CALIBRATION_ADDR = 0xC20;  // Record: PadCalibration
+constexpr uint16_t PUMP_FLOW_ADDR = 0xC80;           // Record: PumpFlowCalibration
+constexpr uint16_t LET_RATE_ADDR = 0xC90;            // Record: LetRateModel
+constexpr uint16_t DOSE_ANCHOR_ADDR = 0xCA0;         // Record: DoseAnchors
+constexpr uint16_t DOSE_CLOCK_ADDR = 0xCB0;          // Record: hourly checkpoint of older firmware
+constexpr uint16_t ACTUATOR_STATS_ADDR = 0xCC0;      // Records: ActuatorRecord per actuator
+constexpr uint16_t ACTUATOR_STATS_END = 0xE00;
+} // namespace EepromMap
+
+// Configuration journal geometry: slots of CONFIG_JOURNAL_SLOT_SIZE bytes
+constexpr uint8_t CONFIG_JOURNAL_SLOT_SIZE = 80;
+constexpr uint8_t CONFIG_JOURNAL_SLOTS =
+    (EepromMap::CONFIG_JOURNAL_END - EepromMap::CONFIG_JOURNAL_ADDR) / CONFIG_JOURNAL_SLOT_SIZE;
+
+// Largest payload storeRecord()/loadRecord() accept
+constexpr uint8_t RECORD_MAX_PAYLOAD = 40;
+
+// Bytes a record occupies in EEPROM: two slots of [sequence][payload][CRC-8]
+constexpr uint16_t recordFootprint(uint8_t payloadSize) { return 2U * (payloadSize + 2U); }
+
+/**
+ * CRC-8 (polynomial 0x07) used by the records and the dose ledger.
+ * @param crc 0, or the CRC of the preceding bytes to continue it
+ */
+uint8_t crc8(uint8_t crc, const void* data, uint8_t size);
+
+/**
+ * Persist a small record so that a reset in the middle of the write never
+ * loses the previous copy: the payload goes to the older of two slots,
+ * stamped with the next sequence number and a CRC-8. Unchanged bytes are
+ * not rewritten (EEPROM.update).
+ * @param address First byte of the record area (recordFootprint() bytes)
+ * @param payload Record contents, size bytes
+ * Side effects: up to size + 2 EEPROM writes (~3.3 ms each).
+ */
+void storeRecord(uint16_t address, const void* payload, uint8_t size);
+
 /**
- * Save configuration to EEPROM
+ * Read the newest intact copy of a record written by storeRecord().
+ * @return false if neither slot holds a valid copy (payload untouched)
+ */
+bool loadRecord(uint16_t address, void* payload, uint8_t size);
+
+/**
+ * Invalidate both slots of a record (loadRecord() then returns false).
+ */
+void eraseRecord(uint16_t address, uint8_t size);
+
+/**
+ * Save configuration to EEPROM: appended to the configuration journal, a
+ * ring of CONFIG_JOURNAL_SLOTS slots in CONFIG_JOURNAL_ADDR..END, each
+ * [format][sequence][length][payload][CRC-8]. Every save goes to the slot
+ * after the newest record, so each cell sees 1/CONFIG_JOURNAL_SLOTS of the
+ * writes, and a save torn by a reset leaves the previous record intact.
  * @param config Configuration struct to save
+ * Side effects: EEPROM writes for the bytes that differ from the slot's old
+ * contents (~3.3 ms each).
  */
 void saveConfiguration(const Configuration& config);
 
 /**
- * Load configuration from EEPROM
+ * Load the newest intact configuration record. Without one, the configuration
+ * of older firmware is migrated: the newest format 1 record (128-byte slots,
+ * 64-bit times) or, before that, the raw struct at address 0. A migrated
+ * format 1 record, or a valid raw struct, is saved as a format 2 record right
+ * away.
  * @return Configuration struct (uses magic values for unset fields)
  */
 Configuration loadConfiguration();
@@ -83,11 +153,27 @@ bool isConfigurationValid(const Configuration& config);
 void loadConfigurationToAppState();
 
 /**
- * Save AppState to configuration
- * Used after any change to persist settings
+ * Commit AppState now, bypassing the quiet period (console `save`). Fields
+ * are compared with the last committed configuration; nothing is written
+ * when none changed.
+ * Side effects: one journal record (~3.3 ms per byte) if a field changed.
  */
 void saveAppStateToConfiguration();
 
+/**
+ * Mark the configuration dirty. Requests are coalesced: the commit happens
+ * once no further request arrived for CONFIG_SAVE_QUIET_MS, or at the latest
+ * CONFIG_SAVE_MAX_DELAY_MS after the first request of the burst.
+ * Side effects: none until flushPendingConfiguration() runs (persistence task).
+ */
+void requestConfigurationSave();
+
+/**
+ * Persistence task body: commits a pending request once its burst has gone
+ * quiet (see requestConfigurationSave()).
+ */
+void flushPendingConfiguration();
+
 /**
  * Factory reset - sets all EEPROM values to unset state
  */
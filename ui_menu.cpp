@@ -0,0 +1,132 @@
+/**
+ * ============================================================================
+ * UI_MENU.CPP - Main Screen and Menu Key Dispatch
+ * ============================================================================
+ */
+
+#include "ui_state.h"
+#include "appstate.h"
+#include "debug.hpp"
+#include "display.h"
+#include "language.h"
+#include "screens.h"
+#include "storage.h"
+#include "water.h"
+#include <Arduino.h>
+
+using UIStateController::currentPumpIndex;
+using UIStateController::showNotice;
+using UIStateController::showTextNotice;
+using UIStateController::transitionTo;
+
+namespace {
+
+uint32_t lastIdleDrawMs = 0;
+bool idleRedrawPending = true;
+
+void displayMainScreen() {
+  lcdPrintWithGlyphs(LANG_BUFFER.status.mainScreen, LANG_MAINSCREEN_LEN, 0, 0);
+  lcdPrintWithGlyphs(LANG_BUFFER.status.noTask, LANG_NOTASK_LEN, 0, 1);
+}
+
+// Redraws the idle or level-status screen at most every UI_IDLE_REDRAW_MS,
+// or right away after another screen was left.
+void refreshIdleScreen() {
+  if (!idleRedrawPending && millis() - lastIdleDrawMs < Hardware::UI_IDLE_REDRAW_MS)
+    return;
+  idleRedrawPending = false;
+  lastIdleDrawMs = millis();
+  WaterLevelResult r = getLastLevelResult();
+  if (r.error != WATER_ERROR_NONE || r.inletPumpActive || r.outletPumpActive) {
+    displayWaterLevelStatus(r);
+  } else {
+    displayMainScreen();
+  }
+}
+
+// Shows "Light ON/OFF" once per light state change (schedule or override).
+// Returns true if the notice was started.
+bool announceLightChange() {
+  static uint8_t announcedState = HIGH; // Light starts OFF
+  if (AppState::lightState == announcedState)
+    return false;
+  announcedState = AppState::lightState;
+  showTextNotice(announcedState == LOW ? "Light ON" : "Light OFF");
+  return true;
+}
+
+void toggleLightOverride() {
+  SerialPrint(TIME, "Manual override of light state requested by user");
+  // The light task applies the new state; the notice follows on this tick.
+  AppState::lightState = (AppState::lightState == HIGH) ? LOW : HIGH;
+  AppState::lightOverrideActive = true;
+}
+
+void showLevelStatus() {
+  SerialPrint(MONITOR, "Manual water-level measurement requested");
+  // Viewing the status acknowledges a latched level-control fault
+  if (getLevelState() == LevelState::FAULT)
+    clearWaterError();
+  displayWaterLevelStatus(getLastLevelResult());
+  showNotice(Hardware::UI_DELAY_LONG_MS);
+}
+
+void runManualCleaning() {
+  SerialPrint(CONFIG, "Manual water cleaning requested by user");
+  if (startWaterCleaningCycle()) {
+    idleRedrawPending = true;
+    return;
+  }
+  // Refused (already running or level FAULT): show why
+  displayWaterLevelStatus(getLastLevelResult());
+  showNotice(Hardware::UI_DELAY_LONG_MS);
+}
+
+void openPumpScreen(char key) {
+  bool manual = key >= '4';
+  currentPumpIndex = manual ? key - '4' : key - '1';
+  SerialPrint(CONFIG, manual ? "User requested manual pump control for pump index "
+                             : "User requested dosing amount edit for pump index ",
+              currentPumpIndex);
+  transitionTo(manual ? UIState::PUMP_MANUAL : UIState::PUMP_CONFIG_VIEW);
+}
+
+// Returns true if the key opened another screen or was fully handled.
+bool dispatchMenuKey(char key) {
+  if (key >= '1' && key <= '6') {
+    openPumpScreen(key);
+    return true;
+  }
+  switch (key) {
+  case 'A': transitionTo(UIState::TANK_VOLUME_EDIT); return true;
+  case 'B': transitionTo(UIState::LANG_CONFIG); return true;
+  case 'C': showLevelStatus(); return true;
+  case 'D': transitionTo(UIState::THRESHOLD_CONFIG_LOW); return true;
+  case '7': transitionTo(UIState::CLEAN_INTERVAL_EDIT); return true;
+  case '8': transitionTo(UIState::LIGHT_OFF_EDIT); return true;
+  case '9': toggleLightOverride(); return false;
+  case '0': transitionTo(UIState::TIME_DISPLAY); return true;
+  case '#': runManualCleaning(); return true;
+  case '*': transitionTo(UIState::FACTORY_RESET_CONFIRM); return true;
+  default:  return false;
+  }
+}
+
+} // namespace
+
+namespace UIStateController {
+
+void enterMainScreen() { idleRedrawPending = true; }
+
+void handleMainScreen(char key) {
+  if (key) {
+    SerialPrint(KEYPAD_INPUT, "Keypad event received: ", key);
+    if (dispatchMenuKey(key))
+      return;
+  }
+  if (announceLightChange())
+    return;
+  refreshIdleScreen();
+}
+
+} // namespace UIStateController
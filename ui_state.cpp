@@ -0,0 +1,453 @@
+/**
+ * ============================================================================
+ * UI_STATE.CPP - Non-blocking UI State Machine
+ * ============================================================================
+ */
+
+#include "ui_state.h"
+#include "appstate.h"
+#include "debug.hpp"
+#include "display.h"
+#include "dose_ledger.h"
+#include "dosing_planner.h"
+#include "language.h"
+#include "pump_engine.h"
+#include "pump_flow.h"
+#include "pumps.h"
+#include "screens.h"
+#include "storage.h"
+#include "water.h"
+#include <Arduino.h>
+
+// Function to trigger software reset via jump to address 0
+// NOLINT_MANUAL_MEMORY: Low-level AVR reset mechanism
+static void (*const softwareReset)(void) = nullptr;
+
+namespace UIStateController {
+UIState currentState = UIState::MAIN_SCREEN;
+uint8_t currentPumpIndex = 0;
+} // namespace UIStateController
+
+using UIStateController::currentPumpIndex;
+using UIStateController::currentState;
+using UIStateController::enterMainScreen;
+using UIStateController::handleMainScreen;
+using UIStateController::showNotice;
+using UIStateController::showTextNotice;
+using UIStateController::transitionTo;
+
+namespace {
+
+// Window after the pump amount view in which '#' opens the editor
+constexpr uint16_t PUMP_FOLLOWUP_WINDOW_MS = 2000;
+// Pause between showing the manual pump screen and switching the pump on
+constexpr uint16_t MANUAL_PUMP_START_DELAY_MS = 1000;
+constexpr uint32_t SECONDS_PER_DAY = 86400UL;
+
+NumberEditor numberEditor;
+TimeEditor timeEditor;
+LanguagePicker languagePicker;
+
+uint32_t stateEnteredMs = 0;
+uint16_t holdMs = 0;          // NOTICE / TIME_DISPLAY lifetime
+bool wizardActive = false;
+uint8_t primePendingMask = 0; // Wizard: dosing lines still waiting to be primed
+uint16_t pendingLowThreshold = 0;
+PumpRunHandle manualRun = PUMP_RUN_NONE;
+uint32_t shownClock = 0;      // TIME_DISPLAY: second currently on the LCD
+
+const __FlashStringHelper* stateName(UIState state) {
+  switch (state) {
+  case UIState::MAIN_SCREEN:               return F("MAIN");
+  case UIState::LANG_CONFIG:               return F("LANG");
+  case UIState::TANK_VOLUME_EDIT:          return F("TANK_VOLUME");
+  case UIState::PUMP_CONFIG_VIEW:          return F("PUMP_VIEW");
+  case UIState::PUMP_CONFIG_FOLLOWUP:      return F("PUMP_FOLLOWUP");
+  case UIState::PUMP_CONFIG_EDIT_AMOUNT:   return F("PUMP_AMOUNT");
+  case UIState::PUMP_CONFIG_EDIT_INTERVAL: return F("PUMP_INTERVAL");
+  case UIState::PUMP_MANUAL:               return F("PUMP_MANUAL");
+  case UIState::THRESHOLD_CONFIG_LOW:      return F("THRESHOLD_LOW");
+  case UIState::THRESHOLD_CONFIG_HIGH:     return F("THRESHOLD_HIGH");
+  case UIState::CLEAN_INTERVAL_EDIT:       return F("CLEAN_INTERVAL");
+  case UIState::CLOCK_EDIT:                return F("CLOCK");
+  case UIState::LIGHT_OFF_EDIT:            return F("LIGHT_OFF");
+  case UIState::LIGHT_ON_EDIT:             return F("LIGHT_ON");
+  case UIState::TIME_DISPLAY:              return F("TIME");
+  case UIState::NOTICE:                    return F("NOTICE");
+  case UIState::FACTORY_RESET_CONFIRM:     return F("FACTORY_RESET");
+  default:                                 return F("UNKNOWN");
+  }
+}
+
+uint32_t elapsedInState() { return millis() - stateEnteredMs; }
+
+uint32_t wallClockSecondsOfDay() {
+  return static_cast<uint32_t>((AppState::timeOffset + seconds()) % SECONDS_PER_DAY);
+}
+
+// ---------------------------------------------------------------------------
+// Editor states
+// ---------------------------------------------------------------------------
+
+// Opens the numeric editor; a stored UNSET value (and every wizard step)
+// starts from 0 in edit mode.
+void openNumber(const NumberFieldSpec& spec, uint32_t value, uint32_t unset, bool editMode) {
+  if (wizardActive || value == unset) {
+    value = 0;
+    editMode = true;
+  }
+  numberEditor.begin(spec, value, editMode);
+}
+
+void enterNumberState(UIState state) {
+  DosingConfig cfg = AppState::pumps[currentPumpIndex].getConfig();
+  switch (state) {
+  case UIState::TANK_VOLUME_EDIT:
+    openNumber(tankVolumeField(), AppState::tankVolume, UNSET_U32, true);
+    break;
+  case UIState::PUMP_CONFIG_VIEW:
+  case UIState::PUMP_CONFIG_EDIT_AMOUNT:
+    openNumber(pumpAmountField(currentPumpIndex), cfg.amount, UNSET_U16,
+               state == UIState::PUMP_CONFIG_EDIT_AMOUNT);
+    break;
+  case UIState::PUMP_CONFIG_EDIT_INTERVAL:
+    openNumber(pumpIntervalField(currentPumpIndex), static_cast<uint32_t>(cfg.interval),
+               UNSET_U32, true);
+    break;
+  case UIState::THRESHOLD_CONFIG_LOW:
+    openNumber(lowThresholdField(), AppState::lowThreshold, UNSET_U16, true);
+    break;
+  case UIState::THRESHOLD_CONFIG_HIGH:
+    openNumber(highThresholdField(), AppState::highThreshold, UNSET_U16, true);
+    break;
+  default: // CLEAN_INTERVAL_EDIT
+    openNumber(cleanIntervalField(), AppState::waterCleaningIntervalDays, UNSET_U16, true);
+    break;
+  }
+}
+
+// Common exit of an editor step. From the menu every exit returns to the
+// main screen (a confirmed value is queued for saving); in the wizard a
+// confirmed step moves on to `wizardNext` and a cancelled one is repeated.
+void leaveStep(ScreenResult result, UIState wizardNext) {
+  if (!wizardActive) {
+    if (result == ScreenResult::DONE)
+      requestConfigurationSave();
+    transitionTo(UIState::MAIN_SCREEN);
+    return;
+  }
+  transitionTo(result == ScreenResult::DONE ? wizardNext : currentState);
+}
+
+void setPumpConfig(uint32_t amount, uint32_t interval) {
+  DosingConfig cfg = AppState::pumps[currentPumpIndex].getConfig();
+  if (amount != UNSET_U32)
+    cfg.amount = static_cast<uint16_t>(amount);
+  if (interval != UNSET_U32)
+    cfg.interval = interval;
+  AppState::pumps[currentPumpIndex].setConfig(cfg);
+  replanDose(currentPumpIndex);
+}
+
+// Wizard: prime the dosing lines configured so far. A line whose relay is
+// still busy is retried from handleCurrentState().
+void primeDosingLines() {
+  for (uint8_t i = 0; i < Hardware::DOSING_PUMP_COUNT; i++) {
+    if (!(primePendingMask & (1U << i)))
+      continue;
+    uint32_t durationMs = doseDurationMs(i, AppState::pumps[i].getConfig().amount);
+    if (durationMs > Hardware::MAX_PUMP_RUN_TIME_MS)
+      durationMs = Hardware::MAX_PUMP_RUN_TIME_MS;
+    if (startPumpRun(pumpIndexToPin(i), static_cast<uint16_t>(durationMs)) != PUMP_RUN_NONE)
+      primePendingMask &= ~(1U << i);
+  }
+}
+
+void onPumpNumber(ScreenResult result) {
+  UIState state = currentState;
+  if (state == UIState::PUMP_CONFIG_VIEW) {
+    if (result == ScreenResult::DONE) {
+      setPumpConfig(numberEditor.value(), UNSET_U32);
+      requestConfigurationSave();
+    }
+    transitionTo(UIState::PUMP_CONFIG_FOLLOWUP);
+    return;
+  }
+  if (result == ScreenResult::DONE && state == UIState::PUMP_CONFIG_EDIT_AMOUNT)
+    setPumpConfig(numberEditor.value(), UNSET_U32);
+  if (result == ScreenResult::DONE && state == UIState::PUMP_CONFIG_EDIT_INTERVAL)
+    setPumpConfig(UNSET_U32, numberEditor.value());
+
+  if (wizardActive && result == ScreenResult::DONE && state == UIState::PUMP_CONFIG_EDIT_AMOUNT)
+    primePendingMask |= 1U << currentPumpIndex;
+  UIState next = UIState::PUMP_CONFIG_EDIT_INTERVAL;
+  if (state == UIState::PUMP_CONFIG_EDIT_INTERVAL) {
+    bool lastPump = currentPumpIndex + 1 >= Hardware::DOSING_PUMP_COUNT;
+    next = lastPump ? UIState::CLOCK_EDIT : UIState::PUMP_CONFIG_EDIT_AMOUNT;
+    if (!lastPump && result == ScreenResult::DONE)
+      currentPumpIndex++;
+  }
+  leaveStep(result, next);
+}
+
+bool thresholdsUsable() {
+  return AppState::lowThreshold != UNSET_U16 && AppState::highThreshold != UNSET_U16;
+}
+
+void onThresholdNumber(ScreenResult result) {
+  if (result == ScreenResult::CANCELLED) {
+    // Leaving is only allowed while the stored pair is still usable
+    bool canLeave = thresholdsUsable() && !wizardActive;
+    transitionTo(canLeave ? UIState::MAIN_SCREEN : UIState::THRESHOLD_CONFIG_LOW);
+    return;
+  }
+  if (currentState == UIState::THRESHOLD_CONFIG_LOW) {
+    pendingLowThreshold = static_cast<uint16_t>(numberEditor.value());
+    transitionTo(UIState::THRESHOLD_CONFIG_HIGH);
+    return;
+  }
+  uint16_t low = pendingLowThreshold;
+  uint32_t high = numberEditor.value();
+  if (low == 0 || high <= low || high > 100) {
+    SerialPrint(CONFIG, "WARN thresholds rejected low=", low, " high=", high);
+    transitionTo(UIState::THRESHOLD_CONFIG_LOW);
+    return;
+  }
+  AppState::lowThreshold = low;
+  AppState::highThreshold = static_cast<uint16_t>(high);
+  leaveStep(result, UIState::CLEAN_INTERVAL_EDIT);
+}
+
+void handleNumberState(char key) {
+  ScreenResult result = numberEditor.update(key);
+  if (result == ScreenResult::ACTIVE)
+    return;
+  switch (currentState) {
+  case UIState::TANK_VOLUME_EDIT:
+    if (result == ScreenResult::DONE)
+      AppState::tankVolume = numberEditor.value();
+    currentPumpIndex = 0;
+    leaveStep(result, UIState::PUMP_CONFIG_EDIT_AMOUNT);
+    break;
+  case UIState::THRESHOLD_CONFIG_LOW:
+  case UIState::THRESHOLD_CONFIG_HIGH:
+    onThresholdNumber(result);
+    break;
+  case UIState::CLEAN_INTERVAL_EDIT:
+    if (result == ScreenResult::DONE)
+      AppState::waterCleaningIntervalDays = static_cast<uint16_t>(numberEditor.value());
+    leaveStep(result, UIState::LIGHT_OFF_EDIT);
+    break;
+  default:
+    onPumpNumber(result);
+    break;
+  }
+}
+
+void finishSetupWizard() {
+  // The first cleaning cycle is due one full interval from now
+  AppState::lastCleaningTime = doseClockNow();
+  wizardActive = false;
+  SerialPrint(CONFIG, "First-run setup wizard finished");
+  requestConfigurationSave();
+  transitionTo(UIState::MAIN_SCREEN);
+}
+
+void onTimeDone(UIState state, uint32_t secondsOfDay) {
+  if (state == UIState::CLOCK_EDIT) {
+    // Wall clock = timeOffset + seconds(). Kept in 0..86399 so it never
+    // collides with the UNSET_U32 sentinel of the stored configuration.
+    uint32_t uptimeOfDay = static_cast<uint32_t>(seconds() % SECONDS_PER_DAY);
+    AppState::timeOffset = (secondsOfDay + SECONDS_PER_DAY - uptimeOfDay) % SECONDS_PER_DAY;
+    SerialPrint(CONFIG, "Clock offset configured (seconds): ",
+                static_cast<uint32_t>(AppState::timeOffset));
+    replanAllDoses(); // Anchored doses follow the new clock
+    transitionTo(UIState::THRESHOLD_CONFIG_LOW);
+  } else if (state == UIState::LIGHT_OFF_EDIT) {
+    AppState::lightOffTime = secondsOfDay;
+    transitionTo(UIState::LIGHT_ON_EDIT);
+  } else if (wizardActive) {
+    AppState::lightOnTime = secondsOfDay;
+    finishSetupWizard();
+  } else {
+    AppState::lightOnTime = secondsOfDay;
+    SerialPrint(LIGHTS, "Light schedule captured: off=",
+                static_cast<uint32_t>(AppState::lightOffTime), " on=", secondsOfDay);
+    requestConfigurationSave();
+    showTextNotice("Light Time Set");
+  }
+}
+
+void handleTimeState(char key) {
+  ScreenResult result = timeEditor.update(key);
+  if (result == ScreenResult::ACTIVE)
+    return;
+  if (result == ScreenResult::DONE)
+    onTimeDone(currentState, timeEditor.value());
+  else
+    transitionTo(wizardActive ? currentState : UIState::MAIN_SCREEN);
+}
+
+void handleLanguageState(char key) {
+  ScreenResult result = languagePicker.update(key);
+  if (result == ScreenResult::ACTIVE)
+    return;
+  AppState::languageIndex = languagePicker.value();
+  readLanguage(AppState::languageIndex, &LANG_BUFFER);
+  SerialPrint(CONFIG, "Language index selected by user: ", AppState::languageIndex,
+              " name=", LANG_BUFFER.general.name);
+  if (wizardActive) {
+    transitionTo(UIState::TANK_VOLUME_EDIT);
+    return;
+  }
+  requestConfigurationSave();
+  showTextNotice("Language Set");
+}
+
+// ---------------------------------------------------------------------------
+// Other states
+// ---------------------------------------------------------------------------
+
+void enterManualPump() {
+  lcd.clear();
+  lcd.setCursor(0, 0);
+  lcd.print("Manual Pump Ctrl");
+  lcd.setCursor(0, 1);
+  lcd.print(currentPumpIndex + 1);
+  manualRun = PUMP_RUN_NONE;
+}
+
+// Runs the dosing pump until any key press, capped at MAX_PUMP_RUN_TIME_MS
+// by the engine.
+void handleManualPump(char key) {
+  if (manualRun == PUMP_RUN_NONE) {
+    if (key) {
+      transitionTo(UIState::MAIN_SCREEN);
+    } else if (elapsedInState() >= MANUAL_PUMP_START_DELAY_MS) {
+      manualRun = startPumpRun(pumpIndexToPin(currentPumpIndex), Hardware::MAX_PUMP_RUN_TIME_MS);
+      if (manualRun == PUMP_RUN_NONE) {
+        SerialPrint(PUMPS, "WARN manual pump control rejected pump=", currentPumpIndex,
+                    " reason=relay busy");
+        transitionTo(UIState::MAIN_SCREEN);
+      }
+    }
+    return;
+  }
+  if (key && stopPumpRun(manualRun))
+    SerialPrint(PUMPS, "Manual pump control for pump ", currentPumpIndex, " stopped by user");
+  PumpRunStatus status = getPumpRunStatus(manualRun);
+  if (status != PumpRunStatus::QUEUED && status != PumpRunStatus::RUNNING)
+    transitionTo(UIState::MAIN_SCREEN);
+}
+
+void enterFactoryReset() {
+  lcd.clear();
+  lcd.setCursor(0, 0);
+  lcd.print("Factory Reset?");
+  lcd.setCursor(0, 1);
+  lcd.print("#=Yes  *=No");
+}
+
+void handleFactoryReset(char key) {
+  if (key == '#') {
+    SerialPrint(FACTORY, "Factory reset confirmed by user; erasing persisted config");
+    factoryReset();
+    lcd.flushAll();
+    delay(Hardware::UI_DELAY_SHORT_MS);
+    softwareReset();
+  } else if (key == '*') {
+    SerialPrint(FACTORY, "Factory reset cancelled by user");
+    transitionTo(UIState::MAIN_SCREEN);
+  }
+}
+
+// Redraws the clock whenever the displayed second changes.
+void handleTimeDisplay(char key) {
+  uint32_t now = wallClockSecondsOfDay();
+  if (now != shownClock) {
+    shownClock = now;
+    showTime(now);
+  }
+  if (key || elapsedInState() >= Hardware::UI_DELAY_MEDIUM_MS)
+    transitionTo(UIState::MAIN_SCREEN);
+}
+
+void handleFollowup(char key) {
+  if (key == '#')
+    transitionTo(UIState::PUMP_CONFIG_EDIT_AMOUNT);
+  else if (key || elapsedInState() >= PUMP_FOLLOWUP_WINDOW_MS)
+    transitionTo(UIState::MAIN_SCREEN);
+}
+
+void enterState(UIState state) {
+  switch (state) {
+  case UIState::MAIN_SCREEN:           enterMainScreen(); break;
+  case UIState::LANG_CONFIG:
+    languagePicker.begin(wizardActive ? 1 : AppState::languageIndex);
+    break;
+  case UIState::CLOCK_EDIT:            timeEditor.begin("", wallClockSecondsOfDay()); break;
+  case UIState::LIGHT_OFF_EDIT:        timeEditor.begin("LightOFF", wallClockSecondsOfDay()); break;
+  case UIState::LIGHT_ON_EDIT:         timeEditor.begin("LightON", wallClockSecondsOfDay()); break;
+  case UIState::PUMP_MANUAL:           enterManualPump(); break;
+  case UIState::FACTORY_RESET_CONFIRM: enterFactoryReset(); break;
+  case UIState::TIME_DISPLAY:          shownClock = UNSET_U32; break; // Drawn on the first tick
+  case UIState::PUMP_CONFIG_FOLLOWUP:
+  case UIState::NOTICE:                break; // Keep the previous screen
+  default:                             enterNumberState(state); break;
+  }
+}
+
+} // namespace
+
+namespace UIStateController {
+
+void transitionTo(UIState newState) {
+  SerialPrint(KEYPAD_INPUT, "UI ", stateName(currentState), " -> ", stateName(newState));
+  currentState = newState;
+  stateEnteredMs = millis();
+  enterState(newState);
+}
+
+void handleCurrentState(char key) {
+  if (primePendingMask != 0)
+    primeDosingLines();
+
+  switch (currentState) {
+  case UIState::MAIN_SCREEN:           handleMainScreen(key); break;
+  case UIState::LANG_CONFIG:           handleLanguageState(key); break;
+  case UIState::CLOCK_EDIT:
+  case UIState::LIGHT_OFF_EDIT:
+  case UIState::LIGHT_ON_EDIT:         handleTimeState(key); break;
+  case UIState::PUMP_MANUAL:           handleManualPump(key); break;
+  case UIState::PUMP_CONFIG_FOLLOWUP:  handleFollowup(key); break;
+  case UIState::FACTORY_RESET_CONFIRM: handleFactoryReset(key); break;
+  case UIState::TIME_DISPLAY:          handleTimeDisplay(key); break;
+  case UIState::NOTICE:
+    if (key || elapsedInState() >= holdMs)
+      transitionTo(UIState::MAIN_SCREEN);
+    break;
+  default:                             handleNumberState(key); break;
+  }
+}
+
+void showNotice(uint16_t ms) {
+  holdMs = ms;
+  transitionTo(UIState::NOTICE);
+}
+
+void showTextNotice(const char* text) {
+  lcd.clear();
+  lcd.setCursor(0, 0);
+  lcd.print(text);
+  showNotice(Hardware::UI_DELAY_MEDIUM_MS);
+}
+
+void startSetupWizard() {
+  SerialPrint(CONFIG, "Configuration missing/invalid; entering first-run setup wizard");
+  wizardActive = true;
+  transitionTo(UIState::LANG_CONFIG);
+}
+
+bool isWizardActive() { return wizardActive; }
+
+} // namespace UIStateController
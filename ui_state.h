@@ -2,6 +2,14 @@
  * ============================================================================
  * UI_STATE.H - Non-blocking UI State Machine Definitions
  * ============================================================================
+ *
+ * The whole user interface is one state machine driven by the UI task: each
+ * tick hands at most one key event to handleCurrentState(), which advances
+ * the active screen and returns. No screen owns a poll loop or calls
+ * delay(), so water control keeps its timing however long a menu stays open.
+ *
+ * Timed notices ("Language Set", the level status, the clock) are states
+ * too and fall back to MAIN_SCREEN once their hold time has elapsed.
  */
 
 #ifndef UI_STATE_H
@@ -10,25 +18,67 @@
 #include <stdint.h>
 
 enum class UIState : uint8_t {
-  MAIN_SCREEN,
-  LANG_CONFIG,
-  TANK_VOLUME_VIEW,
-  TANK_VOLUME_EDIT,
-  PUMP_CONFIG_VIEW,
-  PUMP_CONFIG_EDIT_AMOUNT,
-  PUMP_CONFIG_EDIT_INTERVAL,
-  THRESHOLD_CONFIG_LOW,
+  MAIN_SCREEN,               // Idle/level status, menu key dispatch
+  LANG_CONFIG,               // 'B' / wizard step 1
+  TANK_VOLUME_EDIT,          // 'A' / wizard
+  PUMP_CONFIG_VIEW,          // '1'-'3': amount in view mode
+  PUMP_CONFIG_FOLLOWUP,      // Short window after the view: '#' edits again
+  PUMP_CONFIG_EDIT_AMOUNT,   // Wizard, or '#' from the follow-up window
+  PUMP_CONFIG_EDIT_INTERVAL, // Wizard only
+  PUMP_MANUAL,               // '4'-'6': run a dosing pump until a key press
+  THRESHOLD_CONFIG_LOW,      // 'D' / wizard
   THRESHOLD_CONFIG_HIGH,
-  TIME_DISPLAY,
-  FACTORY_RESET_CONFIRM
+  CLEAN_INTERVAL_EDIT,       // '7' / wizard
+  CLOCK_EDIT,                // Wizard: current time of day
+  LIGHT_OFF_EDIT,            // '8' / wizard
+  LIGHT_ON_EDIT,
+  TIME_DISPLAY,              // '0': live clock
+  NOTICE,                    // Timed message drawn by the previous state
+  FACTORY_RESET_CONFIRM      // '*'
 };
 
 namespace UIStateController {
   extern UIState currentState;
   extern uint8_t currentPumpIndex;
-  
+
+  /**
+   * Leave the current state and enter `newState` (draws its screen).
+   * Re-entering the current state restarts it.
+   */
   void transitionTo(UIState newState);
+
+  /**
+   * UI tick: advance the active state by one step.
+   * @param key Keypad event of this tick, 0 = none
+   */
   void handleCurrentState(char key);
+
+  /**
+   * Show what the caller just drew for `holdMs`, then return to the main
+   * screen (any key dismisses it early).
+   */
+  void showNotice(uint16_t holdMs);
+
+  /**
+   * One-line message on a cleared LCD, held for UI_DELAY_MEDIUM_MS.
+   */
+  void showTextNotice(const char *text);
+
+  // Main screen (ui_menu.cpp): idle/level status redraw and menu keys.
+  void enterMainScreen();
+  void handleMainScreen(char key);
+
+  /**
+   * Start the first-run setup wizard (language, tank, pumps, clock,
+   * thresholds, cleaning interval, light times). Ends in MAIN_SCREEN with
+   * the configuration queued for saving.
+   */
+  void startSetupWizard();
+
+  /**
+   * @return true while the first-run wizard is in progress
+   */
+  bool isWizardActive();
 }
 
 #endif
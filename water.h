@@ -15,40 +15,54 @@
 #include "screens.h"
 
 #include "hardware.h"
+#include "water_sensor.h"
 
 // Forward declaration so functions can reference the result type
 struct WaterLevelResult;
 
-// Error codes for water management
-enum WaterError {
-  WATER_ERROR_NONE = 0,
-  WATER_ERROR_SENSOR_TIMEOUT = 1,
-  WATER_ERROR_SENSOR_COMMUNICATION = 2,
-  WATER_ERROR_SENSOR_INVALID_DATA = 3,
-  WATER_ERROR_PUMP_TIMEOUT = 4
+// Automatic level controller state (see checkWaterLevel)
+enum class LevelState : uint8_t {
+  IDLE,     // Level inside the hysteresis band, inlet/outlet off
+  FILLING,  // Inlet on until lowThreshold is reached
+  DRAINING, // Outlet on until highThreshold is reached
+  FAULT     // Correction timed out; pumps off until clearWaterError()
+};
+
+// Sensor sampling rate chosen by updateSensorSampling()
+enum class SamplingMode : uint8_t {
+  FAST, // Water is moving (pump, cleaning, level trend) or the sensor fails
+  SLOW  // Idle and stable tank: heartbeat rate
+};
+
+// Sensor sampling instrumentation over the last completed window
+struct SamplingStats {
+  SamplingMode mode;        // Current mode
+  uint16_t modeChanges;     // FAST <-> SLOW switches since boot
+  uint16_t framesPerMinute; // Effective frame rate
+  uint16_t busPermille;     // Share of wall time spent in pad transfers
+};
+
+// Side of the pad references a calibration capture sets
+enum class CalibrationPoint : uint8_t {
+  DRY, // Sensor out of the water
+  WET  // Sensor fully submerged
+};
+
+// Water change (cleaning) cycle phase, persisted across resets
+enum class CleaningPhase : uint8_t {
+  IDLE,     // No cycle in progress
+  DRAINING, // Outlet on until lowThreshold is reached
+  FILLING   // Inlet on until highThreshold is reached
 };
 
 // Consolidated pump state structure (reduces global variables from 13 to 1)
 struct WaterPumpState {
-  // Pump runtime tracking
-  uint32_t inletPumpTotalRuntime = 0;
-  uint32_t outletPumpTotalRuntime = 0;
-  unsigned long pumpStartTime = 0;
-  unsigned long pumpDuration = 0;  // Added for non-blocking timing
-  bool pumpActive = false;
-  uint8_t activePumpPin = 0;
+  // Relay on/off state and runtime totals live in the RelayManager
+  // (relay_manager.h); timed runs in the pump engine (pump_engine.h).
 
   // Error tracking
   WaterError currentError = WATER_ERROR_NONE;
 
-  // Hysteresis state
-  bool inletPumpWasActive = false;
-  bool outletPumpWasActive = false;
-
-  // Actual pump running state (for display purposes)
-  bool inletPumpRunning = false;
-  bool outletPumpRunning = false;
-
   // Electrovalve state
   // bool electrovalveActive = false;
   // uint32_t electrovalveTotalRuntime = 0;
@@ -57,28 +71,6 @@ struct WaterPumpState {
   bool autoControlActive = false;
 };
 
-// Encapsulates low/high touch sensor data and reading logic
-class WaterSensor {
-public:
-  WaterSensor();
-  WaterError readSensorData();
-  uint8_t getTouchedSections();
-  uint8_t calculateWaterLevel();
-  uint32_t readWaterLevelRaw();
-  void getCurrentWaterLevel(uint8_t *highBuf, uint8_t *lowBuf);
-  WaterError getLastError() const;
-  bool calibrateSensor(uint8_t sensorType, uint8_t *referenceData);
-  bool isSensorConnected() const;
-
-private:
-  static bool initialized;
-  uint8_t high_data[12];
-  uint8_t low_data[8];
-  WaterError lastError : 3;  // Use bitfield to save memory
-  unsigned long lastSuccessfulRead;
-  bool sensorConnected : 1;  // Use bitfield to save memory
-};
-
 /**
  * Initialize water management system
  * Sets up sensors and pump control pins
@@ -92,12 +84,32 @@ void initWaterManagement();
 void updateWaterManagement();
 
 /**
- * Check water level and auto-control pumps
- * Called periodically from main loop to maintain water levels
- * Only active if pumps are in AUTO mode
+ * Sensor sampling task body: one pad transfer per call, so a full frame
+ * takes two SENSOR ticks. The outcome (error / connected state / pad data)
+ * is kept in the sensor object for checkWaterLevel() and the other consumers.
+ */
+void sampleWaterSensor();
+
+/**
+ * Advance the level controller (IDLE/FILLING/DRAINING/FAULT) by one step
+ * using the most recent sensor sample; never reads the bus or blocks.
+ * Call once per new frame (see SensorFrame::sequence).
+ * @return Level in percent, pump states and error; WATER_ERROR_PUMP_TIMEOUT
+ *         while the controller is latched in FAULT
+ * Side effects: switches the inlet/outlet relays on transitions.
  */
 WaterLevelResult checkWaterLevel();
 
+/**
+ * @return Current level controller state
+ */
+LevelState getLevelState();
+
+/**
+ * @return Outcome of the most recent checkWaterLevel() step (for display)
+ */
+WaterLevelResult getLastLevelResult();
+
 // Pump mode controls moved to pumps module
 
 /**
@@ -125,16 +137,16 @@ void setLowThreshold(uint16_t threshold);
 void setHighThreshold(uint16_t threshold);
 
 /**
- * Get current water level sensor readings (both low and high)
- * Populates provided buffers with raw sensor data
+ * Get the latest complete water level frame (both low and high pads)
+ * Populates provided buffers with raw sensor data; does not touch the bus
+ * (the low chip is chip 0 of WaterSensor, the high chip chip 1)
  * @param highBuf Buffer to store high sensor data (12 bytes)
  * @param lowBuf Buffer to store low sensor data (8 bytes)
  */
 void getCurrentWaterLevel(uint8_t *highBuf, uint8_t *lowBuf);
 
 /**
- * Read water sensor data (internal helper)
- * Performs I2C communication with water level sensors
+ * Copy the latest complete sensor frame (internal helper, no bus access)
  * @param highBuf Buffer for high sensor data (can be NULL)
  * @param lowBuf Buffer for low sensor data (can be NULL)
  */
@@ -148,18 +160,21 @@ void read_water_sensor(uint8_t *highBuf, uint8_t *lowBuf);
 void setWaterThresholds(int16_t low, int16_t high);
 
 /**
- * Get the last error code from water management system
- * @return WaterError code indicating the last error
+ * Get the current error code from water management system. Sensor errors
+ * clear with the next valid reading; a pump timeout stays latched until
+ * clearWaterError().
+ * @return WaterError code indicating the current error
  */
 WaterError getWaterError();
 
 /**
- * Clear water management error state
+ * Clear water management error state.
+ * Also releases the level controller from FAULT back to IDLE.
  */
 void clearWaterError();
 
 /**
- * Check if water sensors are responding properly
+ * Check if water sensors are responding properly (latest frame, no bus access)
  * @return true if sensors are connected and responding
  */
 bool checkSensorHealth();
@@ -171,23 +186,223 @@ bool checkSensorHealth();
 void emergencyStopLetPumps();
 
 /**
- * Perform a full cleaning cycle:
- *  - Run outlet pump until water level <= low threshold
- *  - Run inlet pump until water level >= high threshold
- * This is a blocking routine used for manual or scheduled cleaning.
+ * Request or release the inlet/outlet relay at SAFETY priority (see
+ * relay_manager.h). Shared by the level controller and the cleaning cycle.
+ * The relay may come on a few ticks later if dosing holds the load budget.
+ * @param pumpPin Hardware::INLET_PUMP_PIN or Hardware::OUTLET_PUMP_PIN
+ * @param on true to request the pump, false to stop it (no-op if unchanged)
+ */
+void setLetPump(uint8_t pumpPin, bool on);
+
+/**
+ * Restore a cleaning cycle that was interrupted by a reset from its EEPROM
+ * checkpoint; it continues with the next sensor sample.
+ * Called from initWaterManagement().
+ */
+void initWaterCleaning();
+
+/**
+ * Start a water change in the background: drain to the low threshold, then
+ * refill to the high threshold, one step per sensor sample (see
+ * stepWaterCleaningCycle()). Progress is checkpointed to EEPROM.
+ * @return false if a cycle is already running or the level controller is
+ *         latched in FAULT
+ */
+bool startWaterCleaningCycle();
+
+/**
+ * Advance the cleaning cycle by one valid sensor sample. Called by
+ * checkWaterLevel() in place of the level controller while a cycle runs.
+ * @param level Current water level in percent
+ * @return false if the active phase exceeded CLEANING_PHASE_TIMEOUT_MS
+ *         (the cycle is aborted, both pumps are off)
+ */
+bool stepWaterCleaningCycle(uint8_t level);
+
+/**
+ * Hold the cycle while the sensor reports an error: the phase pump is
+ * switched off and its timeout stops counting until the next valid sample.
+ */
+void pauseWaterCleaningCycle();
+
+/**
+ * Abort a running cycle (pump off, checkpoint erased). lastCleaningTime is
+ * left untouched, so the schedule retries it.
+ */
+void abortWaterCleaningCycle();
+
+/**
+ * @return true while a cleaning cycle is in progress
+ */
+bool isWaterCleaningActive();
+
+/**
+ * @return Current cleaning phase (IDLE when no cycle runs)
+ */
+CleaningPhase getCleaningPhase();
+
+/**
+ * Start a cleaning cycle once waterCleaningIntervalDays have passed since
+ * lastCleaningTime on the dose clock, which keeps counting across resets
+ * (level task). An interval of 0 disables the schedule.
+ */
+void checkCleaningSchedule();
+
+/**
+ * Sampling policy (level task): FAST while the inlet or outlet runs, a
+ * cleaning cycle is active, the level trend exceeds LEVEL_STABLE_RATE or
+ * the sensor reports an error, and for SENSOR_FAST_HOLD_MS after that;
+ * SLOW otherwise. Applies the
+ * SENSOR task period and rolls the instrumentation window.
+ */
+void updateSensorSampling();
+
+/**
+ * @return Sampling mode, switch count, frame rate and bus occupancy
+ */
+SamplingStats getSamplingStats();
+
+/**
+ * Apply the stored per-pad calibration (nominal references if none).
+ */
+void initSensorCalibration();
+
+/**
+ * Start averaging the next CALIBRATION_FRAMES good frames into one side of
+ * every pad's references; the result is applied and stored when done.
+ * Opens a calibration session: level control and cleaning hold (pumps off)
+ * while the sensor is out of place.
+ * @return false if a capture runs already or the sensor is not delivering
+ */
+bool startSensorCalibration(CalibrationPoint point);
+
+/**
+ * Close the calibration session (aborting a capture) and resume level
+ * control.
+ */
+void endSensorCalibration();
+
+/**
+ * Once per new good frame (checkWaterLevel): advances a capture, otherwise
+ * tracks baseline drift of pads away from the waterline.
+ */
+void stepSensorCalibration();
+
+/**
+ * @return true while a calibration session is open; closes one that
+ *         exceeded CALIBRATION_SESSION_TIMEOUT_MS
+ */
+bool isSensorCalibrating();
+
+/**
+ * Return every pad to the nominal references, erase the stored profile and
+ * close the session.
+ */
+void resetSensorCalibration();
+
+/**
+ * Print one side of the pad references (two lines, console report).
+ */
+void printSensorCalibration(CalibrationPoint point);
+
+/**
+ * Feed the sensor's latest frame into the level filter: majority vote on
+ * the touch masks of the last LEVEL_VOTE_WINDOW frames, interpolation of
+ * the voted waterline from the raw pad values, then an EMA. Constant time
+ * per call. The first frame after a reset primes the filter.
+ */
+void updateLevelFilter(const WaterSensor &sensor);
+
+/**
+ * Discard the filter history, e.g. after a sensor error.
+ */
+void resetLevelFilter();
+
+/**
+ * @return Filtered water level percentage (0-100), rounded
+ */
+uint8_t getFilteredLevel();
+
+/**
+ * @return Filtered water level in 1/256 % (0-25600)
+ */
+uint16_t getFilteredLevelQ8();
+
+/**
+ * Trend of the filtered level over the last LEVEL_TREND_WINDOW_MS.
+ * @return Tenths of a percent per minute, positive while rising; 0 until a
+ *         full window has passed since the filter was primed
+ */
+int16_t levelRatePerMinute();
+
+/**
+ * Load the learned inlet/outlet rates (water_rate.cpp).
+ */
+void initLetRateModel();
+
+/**
+ * Learn from inlet/outlet runs (level task, every checkWaterLevel()). A run
+ * of one pump between two settled levels yields one rate observation; the
+ * estimate is only marked dirty, flushLetRateModel() stores it.
+ * @param levelValid false on a sensor error: a sample in progress is lost
+ */
+void observeLetPumps(bool levelValid);
+
+/**
+ * PERSIST task: store the rate model if an observation changed it.
+ */
+void flushLetRateModel();
+
+/**
+ * Inlet/outlet on-time predicted to move the level by `deltaQ8`.
+ * @param pumpPin Hardware::INLET_PUMP_PIN or Hardware::OUTLET_PUMP_PIN
+ * @param deltaQ8 Level change in 1/256 %
+ * @return Milliseconds, 0 while the pump's rate is not learned yet
+ */
+uint32_t predictLetPumpMs(uint8_t pumpPin, uint16_t deltaQ8);
+
+/**
+ * Start a correction towards a threshold (level controller or cleaning
+ * phase): forgets the previous pulse.
+ */
+void beginLetCorrection();
+
+/**
+ * Pump decision for one step of a correction: a pulse of the predicted
+ * length from a settled level, then off until the level settles again and
+ * the next (trim) pulse is planned. The pulse is timed from the moment the
+ * relay actually switches on, not from the request, so a relay waiting for
+ * the load budget still runs for the predicted length. With an unknown rate
+ * the pump stays on.
+ * The caller ends the correction when the threshold is reached.
+ * @param targetPercent Threshold the correction moves towards
+ * @return true while the pump should be on
+ */
+bool stepLetCorrection(uint8_t pumpPin, uint8_t targetPercent);
+
+/**
+ * Forget the learned rates and erase them from EEPROM.
+ */
+void resetLetRateModel();
+
+/**
+ * Print the learned rates (one line, console report).
  */
-void runWaterCleaningCycle();
+void printLetRateModel();
 
 /**
  * Calculate pump duration based on water level deviation from threshold
+ * (inlet when rising, outlet when falling), from the learned rate model;
+ * 1000 ms + 100 ms per percent while that pump's rate is not learned yet
  * @param currentLevel Current water level percentage (0-100)
  * @param threshold Target threshold percentage (low or high)
- * @return Duration in milliseconds to run the pump
+ * @return Duration in milliseconds to run the pump (max MAX_PUMP_RUN_TIME_MS)
  */
 uint16_t calculatePumpDuration(uint8_t currentLevel, uint8_t target);
 
 /**
- * Get pump runtime statistics
+ * Get pump runtime statistics since boot (RelayManager on-time); the
+ * persistent counters of every actuator are in actuator_stats.h
  * @param inletRuntime Returns total inlet pump runtime in ms
  * @param outletRuntime Returns total outlet pump runtime in ms
  */
@@ -221,7 +436,6 @@ void displayWaterLevelStatus(const WaterLevelResult &result);
  */
 // bool isElectrovalveOpen();
 
-void handleManualPumpControl(uint8_t idx);
 // /**
 //  * Check if any pump is currently active
 //  * @return true if pump is running, false otherwise
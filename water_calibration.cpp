@@ -0,0 +1,206 @@
+/**
+ * ============================================================================
+ * WATER_CALIBRATION.CPP - Per-Pad Sensor Calibration and Drift Tracking
+ * ============================================================================
+ *
+ * A capture averages CALIBRATION_FRAMES frames into the dry (sensor out of
+ * the water) or wet (fully submerged) reference of every pad. The first
+ * capture opens a session that holds level control and cleaning (the
+ * sensor is being moved) until endSensorCalibration() or
+ * CALIBRATION_SESSION_TIMEOUT_MS after the last capture; pads whose
+ * span would drop below CALIBRATION_MIN_SPAN keep their old values. The
+ * profile is stored as a two-slot record and applied at boot; each pad is
+ * then wet above the midpoint of its own references.
+ *
+ * While the tank is idle, pads well above the waterline pull their dry
+ * reference and pads well below it their wet reference one count per
+ * CALIBRATION_DRIFT_INTERVAL_MS towards the reading, following slow
+ * changes of the pads and the water without a new capture.
+ */
+
+#include "debug.hpp"
+#include "hardware.h"
+#include "storage.h"
+#include "water.h"
+#include <Arduino.h>
+#include <stdint.h>
+
+extern WaterSensor waterSensor;
+
+namespace {
+
+constexpr uint8_t PAD_COUNT = WaterSensor::PAD_COUNT;
+
+struct PadCalibration {
+  uint8_t dry[PAD_COUNT];
+  uint8_t wet[PAD_COUNT];
+};
+
+static_assert(sizeof(PadCalibration) <= RECORD_MAX_PAYLOAD, "calibration must fit one record");
+
+bool sessionActive = false;
+uint32_t sessionStartMs = 0; // Start of the latest capture
+bool capturing = false;
+CalibrationPoint capturePoint = CalibrationPoint::DRY;
+uint8_t framesTaken = 0;
+uint16_t sums[PAD_COUNT];
+
+uint32_t lastDriftMs = 0;
+uint32_t lastSaveMs = 0;
+bool driftUnsaved = false;
+
+const __FlashStringHelper* pointName(CalibrationPoint point) {
+  return point == CalibrationPoint::DRY ? F("DRY") : F("WET");
+}
+
+void saveProfile() {
+  PadCalibration profile;
+  for (uint8_t pad = 0; pad < PAD_COUNT; pad++)
+    waterSensor.getPadReference(pad, &profile.dry[pad], &profile.wet[pad]);
+  storeRecord(EepromMap::SENSOR_CALIBRATION_ADDR, &profile, sizeof(profile));
+  lastSaveMs = millis();
+  driftUnsaved = false;
+}
+
+// Sets one side of a pad's references if the span stays usable.
+bool applyReference(uint8_t pad, CalibrationPoint point, uint8_t value) {
+  uint8_t dry, wet;
+  waterSensor.getPadReference(pad, &dry, &wet);
+  if (point == CalibrationPoint::DRY)
+    dry = value;
+  else
+    wet = value;
+  if (wet < dry + Hardware::CALIBRATION_MIN_SPAN)
+    return false;
+  return waterSensor.setPadReference(pad, dry, wet);
+}
+
+void finishCapture() {
+  capturing = false;
+  uint8_t accepted = 0;
+  for (uint8_t pad = 0; pad < PAD_COUNT; pad++) {
+    uint8_t average = static_cast<uint8_t>(sums[pad] / Hardware::CALIBRATION_FRAMES);
+    if (applyReference(pad, capturePoint, average))
+      accepted++;
+  }
+  saveProfile();
+  SerialPrint(WATER, "Sensor calibration ", pointName(capturePoint), " done accepted=", accepted,
+              " rejected=", PAD_COUNT - accepted);
+}
+
+void stepCapture() {
+  for (uint8_t pad = 0; pad < PAD_COUNT; pad++)
+    sums[pad] += waterSensor.padValue(pad);
+  if (++framesTaken >= Hardware::CALIBRATION_FRAMES)
+    finishCapture();
+}
+
+// Moves one reference a single count towards the pad's reading.
+bool nudgeReference(uint8_t pad, CalibrationPoint point) {
+  uint8_t dry, wet;
+  waterSensor.getPadReference(pad, &dry, &wet);
+  uint8_t current = point == CalibrationPoint::DRY ? dry : wet;
+  uint8_t value = waterSensor.padValue(pad);
+  if (value == current)
+    return false;
+  return applyReference(pad, point, value > current ? current + 1 : current - 1);
+}
+
+// Only on an idle, stable tank: pads two or more away from the waterline.
+void trackDrift(uint32_t now) {
+  if (now - lastDriftMs < Hardware::CALIBRATION_DRIFT_INTERVAL_MS)
+    return;
+  lastDriftMs = now;
+  if (getSamplingStats().mode != SamplingMode::SLOW)
+    return;
+  // First pad not fully wet
+  uint8_t waterline = static_cast<uint8_t>(getFilteredLevelQ8() * static_cast<uint32_t>(PAD_COUNT) / 25600U);
+  for (uint8_t pad = 0; pad < PAD_COUNT; pad++) {
+    if (pad >= waterline + 2 && nudgeReference(pad, CalibrationPoint::DRY))
+      driftUnsaved = true;
+    else if (pad + 2 <= waterline && nudgeReference(pad, CalibrationPoint::WET))
+      driftUnsaved = true;
+  }
+  if (driftUnsaved && now - lastSaveMs >= Hardware::CALIBRATION_SAVE_INTERVAL_MS)
+    saveProfile();
+}
+
+} // namespace
+
+void initSensorCalibration() {
+  PadCalibration profile;
+  if (!loadRecord(EepromMap::SENSOR_CALIBRATION_ADDR, &profile, sizeof(profile))) {
+    SerialPrint(WATER, "No sensor calibration stored; using nominal pad references");
+    return;
+  }
+  uint8_t applied = 0;
+  for (uint8_t pad = 0; pad < PAD_COUNT; pad++) {
+    if (waterSensor.setPadReference(pad, profile.dry[pad], profile.wet[pad]))
+      applied++;
+  }
+  lastSaveMs = millis();
+  SerialPrint(WATER, "Sensor calibration loaded pads=", applied);
+}
+
+bool startSensorCalibration(CalibrationPoint point) {
+  if (capturing || !waterSensor.isSensorConnected()) {
+    SerialPrint(WATER, "WARN sensor calibration not started capturing=", capturing,
+                " connected=", waterSensor.isSensorConnected());
+    return false;
+  }
+  if (!sessionActive)
+    SerialPrint(WATER, "Sensor calibration session opened; level control on hold");
+  sessionActive = true;
+  sessionStartMs = millis();
+  capturing = true;
+  capturePoint = point;
+  framesTaken = 0;
+  memset(sums, 0, sizeof(sums));
+  SerialPrint(WATER, "Sensor calibration ", pointName(point), " started frames=",
+              Hardware::CALIBRATION_FRAMES);
+  return true;
+}
+
+void stepSensorCalibration() {
+  if (capturing)
+    stepCapture();
+  else
+    trackDrift(millis());
+}
+
+void endSensorCalibration() {
+  if (!sessionActive)
+    return;
+  capturing = false;
+  sessionActive = false;
+  SerialPrint(WATER, "Sensor calibration session closed; level control resumed");
+}
+
+bool isSensorCalibrating() {
+  if (sessionActive && !capturing &&
+      millis() - sessionStartMs >= Hardware::CALIBRATION_SESSION_TIMEOUT_MS) {
+    SerialPrint(WATER, "WARN sensor calibration session timed out");
+    endSensorCalibration();
+  }
+  return sessionActive;
+}
+
+void resetSensorCalibration() {
+  endSensorCalibration();
+  waterSensor.resetPadReferences();
+  eraseRecord(EepromMap::SENSOR_CALIBRATION_ADDR, sizeof(PadCalibration));
+  driftUnsaved = false;
+  SerialPrint(WATER, "Sensor calibration reset to nominal pad references");
+}
+
+void printSensorCalibration(CalibrationPoint point) {
+  SerialPrint(WATER, "calibration point=", pointName(point), " session=", sessionActive,
+              " capturing=", capturing, " driftUnsaved=", driftUnsaved);
+  Serial.print(F("  pads="));
+  for (uint8_t pad = 0; pad < PAD_COUNT; pad++) {
+    uint8_t dry, wet;
+    waterSensor.getPadReference(pad, &dry, &wet);
+    Serial.print(point == CalibrationPoint::DRY ? dry : wet);
+    Serial.print(pad + 1 < PAD_COUNT ? ',' : '\n');
+  }
+}
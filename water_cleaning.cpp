@@ -0,0 +1,186 @@
+/**
+ * ============================================================================
+ * WATER_CLEANING.CPP - Resumable Water Change Cycle
+ * ============================================================================
+ *
+ * The cleaning cycle drains the tank to the low threshold and refills it to
+ * the high threshold. It is stepped once per sensor sample by
+ * checkWaterLevel() and never blocks: the phase pump runs the pulses planned
+ * by the learned rate model (stepLetCorrection()) until the sensor reports
+ * the target level.
+ *
+ * Phase, pump on-time and start timestamp are checkpointed to EEPROM on every
+ * phase change and once a minute, so a reset in the middle of a water change
+ * resumes the interrupted phase instead of leaving the tank half drained.
+ */
+
+#include "appstate.h"
+#include "debug.hpp"
+#include "dose_ledger.h"
+#include "hardware.h"
+#include "screens.h"
+#include "storage.h"
+#include "water.h"
+#include <Arduino.h>
+#include <stdint.h>
+
+namespace {
+
+// Persisted cycle state (EepromMap::CLEANING_CHECKPOINT_ADDR)
+struct CleaningCheckpoint {
+  uint8_t phase;         // CleaningPhase
+  uint8_t startLevel;    // Level when the cycle started, percent
+  uint16_t phaseRunSec;  // Pump on-time spent in the current phase
+  uint64_t startedAt;    // Dose clock (dose_ledger.h) at the start
+};
+
+CleaningCheckpoint checkpoint = {static_cast<uint8_t>(CleaningPhase::IDLE), 0, 0, 0};
+uint32_t phaseRunMs = 0;       // Pump on-time in the current phase
+uint32_t lastStepMs = 0;       // millis() of the previous step
+uint32_t lastCheckpointMs = 0; // millis() of the last EEPROM checkpoint
+
+CleaningPhase phase() { return static_cast<CleaningPhase>(checkpoint.phase); }
+
+const __FlashStringHelper* phaseName(CleaningPhase p) {
+  switch (p) {
+  case CleaningPhase::IDLE:     return F("IDLE");
+  case CleaningPhase::DRAINING: return F("DRAINING");
+  case CleaningPhase::FILLING:  return F("FILLING");
+  default:                      return F("UNKNOWN");
+  }
+}
+
+uint8_t phasePumpPin(CleaningPhase p) {
+  return p == CleaningPhase::DRAINING ? Hardware::OUTLET_PUMP_PIN : Hardware::INLET_PUMP_PIN;
+}
+
+uint8_t phaseTarget(CleaningPhase p) {
+  return p == CleaningPhase::DRAINING ? AppState::lowThreshold : AppState::highThreshold;
+}
+
+void saveCheckpoint() {
+  checkpoint.phaseRunSec = static_cast<uint16_t>(phaseRunMs / 1000UL);
+  storeRecord(EepromMap::CLEANING_CHECKPOINT_ADDR, &checkpoint, sizeof(checkpoint));
+  lastCheckpointMs = millis();
+}
+
+// Single place where the cycle changes phase: stops the old pump, logs
+// "<from> -> <to>" and checkpoints (or erases the checkpoint on IDLE).
+void enterPhase(CleaningPhase next, const __FlashStringHelper* trigger, uint8_t level) {
+  if (phase() != CleaningPhase::IDLE)
+    setLetPump(phasePumpPin(phase()), false);
+  SerialPrint(WATER, "Cleaning ", phaseName(phase()), " -> ", phaseName(next), " trigger=", trigger,
+              " level=", level, "%");
+  checkpoint.phase = static_cast<uint8_t>(next);
+  phaseRunMs = 0;
+  lastStepMs = millis();
+  beginLetCorrection();
+  if (next == CleaningPhase::IDLE)
+    eraseRecord(EepromMap::CLEANING_CHECKPOINT_ADDR, sizeof(checkpoint));
+  else
+    saveCheckpoint();
+}
+
+// Adds the time the phase pump ran since the previous step.
+void accumulateRunTime(uint32_t now) {
+  bool pumpOn = phase() == CleaningPhase::DRAINING ? getLastLevelResult().outletPumpActive
+                                                   : getLastLevelResult().inletPumpActive;
+  if (pumpOn)
+    phaseRunMs += now - lastStepMs;
+  lastStepMs = now;
+}
+
+void finishCycle(uint8_t level) {
+  enterPhase(CleaningPhase::IDLE, F("target"), level);
+  AppState::lastCleaningTime = checkpoint.startedAt;
+  requestConfigurationSave();
+  SerialPrint(WATER, "Water cleaning cycle finished startLevel=", checkpoint.startLevel,
+              "% endLevel=", level, "%");
+}
+
+} // namespace
+
+void initWaterCleaning() {
+  if (!loadRecord(EepromMap::CLEANING_CHECKPOINT_ADDR, &checkpoint, sizeof(checkpoint)))
+    checkpoint.phase = static_cast<uint8_t>(CleaningPhase::IDLE);
+  if (phase() != CleaningPhase::DRAINING && phase() != CleaningPhase::FILLING) {
+    checkpoint.phase = static_cast<uint8_t>(CleaningPhase::IDLE);
+    return;
+  }
+  phaseRunMs = checkpoint.phaseRunSec * 1000UL;
+  lastStepMs = millis();
+  lastCheckpointMs = lastStepMs;
+  SerialPrint(WATER, "Resuming interrupted cleaning cycle phase=", phaseName(phase()),
+              " phaseRunSec=", checkpoint.phaseRunSec, " startLevel=", checkpoint.startLevel, "%");
+}
+
+bool startWaterCleaningCycle() {
+  if (isWaterCleaningActive() || getLevelState() == LevelState::FAULT) {
+    SerialPrint(WATER, "WARN cleaning cycle not started active=", isWaterCleaningActive(),
+                " levelFault=", getLevelState() == LevelState::FAULT);
+    return false;
+  }
+  checkpoint.startLevel = getLastLevelResult().level;
+  checkpoint.startedAt = doseClockNow();
+  SerialPrint(WATER, "Starting water cleaning cycle level=", checkpoint.startLevel, "%");
+  enterPhase(CleaningPhase::DRAINING, F("start"), checkpoint.startLevel);
+  return true;
+}
+
+bool stepWaterCleaningCycle(uint8_t level) {
+  uint32_t now = millis();
+  accumulateRunTime(now);
+  if (phase() == CleaningPhase::DRAINING && level <= AppState::lowThreshold) {
+    enterPhase(CleaningPhase::FILLING, F("low"), level);
+  } else if (phase() == CleaningPhase::FILLING && level >= AppState::highThreshold) {
+    finishCycle(level);
+    return true;
+  }
+
+  if (phaseRunMs >= Hardware::CLEANING_PHASE_TIMEOUT_MS) {
+    SerialPrint(WATER, "ERROR code=WATER_ERROR_PUMP_TIMEOUT cleaning phase=", phaseName(phase()),
+                " runMs=", phaseRunMs, " limitMs=", Hardware::CLEANING_PHASE_TIMEOUT_MS,
+                " level=", level, "%");
+    enterPhase(CleaningPhase::IDLE, F("timeout"), level);
+    return false;
+  }
+  setLetPump(phasePumpPin(phase()), stepLetCorrection(phasePumpPin(phase()), phaseTarget(phase())));
+  if (now - lastCheckpointMs >= Hardware::CLEANING_CHECKPOINT_INTERVAL_MS)
+    saveCheckpoint();
+  return true;
+}
+
+void pauseWaterCleaningCycle() {
+  accumulateRunTime(millis());
+  setLetPump(phasePumpPin(phase()), false);
+  beginLetCorrection(); // Re-plan from the settled level once the sensor is back
+}
+
+void abortWaterCleaningCycle() {
+  if (isWaterCleaningActive())
+    enterPhase(CleaningPhase::IDLE, F("abort"), getLastLevelResult().level);
+}
+
+bool isWaterCleaningActive() { return phase() != CleaningPhase::IDLE; }
+
+CleaningPhase getCleaningPhase() { return phase(); }
+
+void checkCleaningSchedule() {
+  if (AppState::waterCleaningIntervalDays == 0 || isWaterCleaningActive() ||
+      getLevelState() == LevelState::FAULT)
+    return;
+  // The dose clock keeps counting across resets, so a reboot neither
+  // postpones nor repeats a cycle. A stamp ahead of it can only come from
+  // firmware that stamped with the wall clock; it restarts the interval once.
+  uint32_t now = doseClockNow();
+  if (now < AppState::lastCleaningTime) {
+    AppState::lastCleaningTime = now;
+    requestConfigurationSave();
+    return;
+  }
+  uint64_t intervalSecs = static_cast<uint64_t>(AppState::waterCleaningIntervalDays) * 86400ULL;
+  if (now - AppState::lastCleaningTime >= intervalSecs) {
+    SerialPrint(WATER, "Automatic water cleaning interval reached");
+    startWaterCleaningCycle();
+  }
+}
@@ -7,24 +7,26 @@
 #include "appstate.h"
 #include "debug.hpp"
 #include "hardware.h"
+#include "latency.h"
+#include "pump_engine.h"
 #include "pumps.h"
-#include "display.h"
+#include "relay_manager.h"
 #include "water.h"
 #include <Arduino.h>
 #include <stdint.h>
 
 extern WaterSensor waterSensor;
-static WaterPumpState pumpState;
+extern WaterPumpState pumpState; // Owned by pump_engine.cpp
 
 void initWaterManagement() {
-  pinMode(Hardware::INLET_PUMP_PIN, OUTPUT);
-  pinMode(Hardware::OUTLET_PUMP_PIN, OUTPUT);
+  RelayManager::init();
   // pinMode(Hardware::ELECTROVALVE_PIN, OUTPUT);
-  digitalWrite(Hardware::INLET_PUMP_PIN, HIGH);
-  digitalWrite(Hardware::OUTLET_PUMP_PIN, HIGH);
   // digitalWrite(Hardware::ELECTROVALVE_PIN, HIGH);
 
   initPumpModes();
+  initWaterCleaning();
+  initSensorCalibration();
+  initLetRateModel();
 
   if (AppState::lowThreshold >= AppState::highThreshold) {
     AppState::lowThreshold = 30;
@@ -32,145 +34,205 @@ void initWaterManagement() {
   }
 }
 
-void runPumpSafely(uint8_t pumpPin, uint16_t duration) {
-  if (pumpState.pumpActive)
-    return;
+void setLetPump(uint8_t pumpPin, bool on) {
+  // Drain/fill outranks dosing when the relay load budget is exhausted
+  if (on)
+    RelayManager::request(pumpPin, RelayPriority::SAFETY);
+  else
+    RelayManager::release(pumpPin);
+}
 
-  // controlElectrovalve(true);
-  delay(500);
-
-  if (duration > Hardware::MAX_PUMP_RUN_TIME_MS)
-    duration = Hardware::MAX_PUMP_RUN_TIME_MS;
-
-  pumpState.pumpActive = true;
-  pumpState.activePumpPin = pumpPin;
-  pumpState.pumpStartTime = millis();
-
-  if (pumpPin == Hardware::INLET_PUMP_PIN)
-    pumpState.inletPumpRunning = true;
-  else if (pumpPin == Hardware::OUTLET_PUMP_PIN)
-    pumpState.outletPumpRunning = true;
-
-  digitalWrite(pumpPin, LOW);
-
-  if (pumpPin == Hardware::INLET_PUMP_PIN)
-    pumpState.inletPumpTotalRuntime += duration;
-  else if (pumpPin == Hardware::OUTLET_PUMP_PIN)
-    pumpState.outletPumpTotalRuntime += duration;
-
-  unsigned long startWait = millis();
-  // while (millis() - startWait < duration) {
-  //   if (millis() - pumpState.pumpStartTime > Hardware::MAX_PUMP_RUN_TIME_MS)
-  //     break;
-  //   delay(100);
-  // }
-  delay(duration);
-
-  digitalWrite(pumpPin, HIGH);
-  pumpState.pumpActive = false;
-  // controlElectrovalve(false);
-
-  if (pumpPin == Hardware::INLET_PUMP_PIN) {
-    pumpState.inletPumpWasActive = false;
-    pumpState.inletPumpRunning = false;
-  } else if (pumpPin == Hardware::OUTLET_PUMP_PIN) {
-    pumpState.outletPumpWasActive = false;
-    pumpState.outletPumpRunning = false;
+// Relay states as published in WaterLevelResult
+static WaterLevelResult levelResult(WaterError error, uint8_t level) {
+  return {error, level, RelayManager::isOn(Hardware::INLET_PUMP_PIN),
+          RelayManager::isOn(Hardware::OUTLET_PUMP_PIN)};
+}
+
+// ---------------------------------------------------------------------------
+// Level controller
+// ---------------------------------------------------------------------------
+//
+// IDLE -> FILLING when the level drops below lowThreshold - hysteresis,
+// FILLING -> IDLE once lowThreshold is reached again (DRAINING mirrors this
+// around highThreshold). While correcting, the pump runs in pulses predicted
+// by the learned rate model (stepLetCorrection()). A correction that does
+// not reach its threshold within LEVEL_CORRECTION_TIMEOUT_MS latches FAULT
+// until clearWaterError().
+//
+// The inlet/outlet relays are requested from the RelayManager directly
+// rather than run through the pump engine: engine runs have a fixed
+// duration, while these are ended by the sensor (an open-ended run while the
+// rate is unknown, otherwise a pulse followed by a settle wait) and are
+// queued with SAFETY priority ahead of dosing.
+
+namespace {
+
+LevelState levelState = LevelState::IDLE;
+uint32_t levelStateSinceMs = 0; // millis() of the last transition
+WaterLevelResult lastLevelResult = {WATER_ERROR_NONE, 0, false, false};
+uint16_t filteredSequence = 0; // Last sensor frame fed to the level filter
+
+const __FlashStringHelper* levelStateName(LevelState state) {
+  switch (state) {
+  case LevelState::IDLE:     return F("IDLE");
+  case LevelState::FILLING:  return F("FILLING");
+  case LevelState::DRAINING: return F("DRAINING");
+  case LevelState::FAULT:    return F("FAULT");
+  default:                   return F("UNKNOWN");
   }
 }
 
-WaterLevelResult checkWaterLevel() {
-  WaterError error = waterSensor.readSensorData();
-  if (error != WATER_ERROR_NONE) {
-    pumpState.currentError = error;
-    return {error, 0, pumpState.inletPumpRunning, pumpState.outletPumpRunning};
+// Relay for the correcting pump of a state, or 0 for states without one.
+uint8_t levelPumpPin(LevelState state) {
+  if (state == LevelState::FILLING)
+    return Hardware::INLET_PUMP_PIN;
+  if (state == LevelState::DRAINING)
+    return Hardware::OUTLET_PUMP_PIN;
+  return 0;
+}
+
+// Switches the pump of the current state on or off.
+void setLevelPump(LevelState state, bool on) {
+  uint8_t pin = levelPumpPin(state);
+  if (pin != 0)
+    setLetPump(pin, on);
+}
+
+// Single place where the controller changes state: stops the old pump,
+// starts a new correction and logs "<from> -> <to>".
+void enterLevelState(LevelState next, const __FlashStringHelper* trigger, uint8_t level) {
+  if (next == levelState)
+    return;
+  setLevelPump(levelState, false);
+  SerialPrint(WATER, "LevelControl ", levelStateName(levelState), " -> ", levelStateName(next),
+              " trigger=", trigger, " level=", level, "%");
+  levelState = next;
+  levelStateSinceMs = millis();
+  if (levelPumpPin(next) != 0)
+    beginLetCorrection();
+}
+
+// FILLING/DRAINING step towards `target`; `reached` once it is met.
+void stepCorrection(bool reached, uint8_t target, uint8_t level) {
+  if (reached) {
+    enterLevelState(LevelState::IDLE, F("target"), level);
+    return;
   }
-  if (!waterSensor.isSensorConnected()) {
-    return {WATER_ERROR_SENSOR_TIMEOUT, 0, pumpState.inletPumpRunning, pumpState.outletPumpRunning};
+  uint32_t elapsedMs = millis() - levelStateSinceMs;
+  if (elapsedMs < Hardware::LEVEL_CORRECTION_TIMEOUT_MS) {
+    setLevelPump(levelState, stepLetCorrection(levelPumpPin(levelState), target));
+    return;
   }
+  SerialPrint(WATER, "ERROR code=WATER_ERROR_PUMP_TIMEOUT state=", levelStateName(levelState),
+              " elapsedMs=", elapsedMs, " limitMs=", Hardware::LEVEL_CORRECTION_TIMEOUT_MS,
+              " level=", level, "%");
+  pumpState.currentError = WATER_ERROR_PUMP_TIMEOUT;
+  enterLevelState(LevelState::FAULT, F("timeout"), level);
+}
 
-  uint8_t currentLevel = waterSensor.calculateWaterLevel();
-
-  if (currentLevel < AppState::lowThreshold - Hardware::HYSTERESIS_MARGIN_PERCENT) {
-    if (!pumpState.inletPumpWasActive) {
-      pumpState.inletPumpWasActive = true;
-      // digitalWrite(Hardware::ELECTROVALVE_PIN, LOW);
-      digitalWrite(Hardware::INLET_PUMP_PIN, LOW);
-      pumpState.inletPumpRunning = true;
-      lcdPrintWithGlyphs(LANG_BUFFER.status.inletPumpOn, LANG_PUMP_STATUS_LEN, 0, 1);
-      while (waterSensor.calculateWaterLevel() < AppState::lowThreshold) {
-        delay(100);
-      }
-      digitalWrite(Hardware::INLET_PUMP_PIN, HIGH);
-      pumpState.inletPumpRunning = false;
-      // digitalWrite(Hardware::ELECTROVALVE_PIN, HIGH);
-      pumpState.inletPumpWasActive = false;
-    }
+// Advances the controller by one sensor sample.
+void stepLevelControl(uint8_t level) {
+  switch (levelState) {
+  case LevelState::IDLE:
+    if (level < AppState::lowThreshold - Hardware::HYSTERESIS_MARGIN_PERCENT)
+      enterLevelState(LevelState::FILLING, F("low"), level);
+    else if (level > AppState::highThreshold + Hardware::HYSTERESIS_MARGIN_PERCENT)
+      enterLevelState(LevelState::DRAINING, F("high"), level);
+    break;
+  case LevelState::FILLING:
+    stepCorrection(level >= AppState::lowThreshold, AppState::lowThreshold, level);
+    break;
+  case LevelState::DRAINING:
+    stepCorrection(level <= AppState::highThreshold, AppState::highThreshold, level);
+    break;
+  default: // FAULT: pumps stay off until clearWaterError()
+    break;
   }
+}
 
-  if (currentLevel > AppState::highThreshold + Hardware::HYSTERESIS_MARGIN_PERCENT) {
-    if (!pumpState.outletPumpWasActive) {
-      pumpState.outletPumpWasActive = true;
-      digitalWrite(Hardware::OUTLET_PUMP_PIN, LOW);
-      pumpState.outletPumpRunning = true;
-      lcdPrintWithGlyphs(LANG_BUFFER.status.outletPumpOn, LANG_PUMP_STATUS_LEN, 0, 1);
-      while (waterSensor.calculateWaterLevel() > AppState::highThreshold) {
-        delay(100);
-      }
-      digitalWrite(Hardware::OUTLET_PUMP_PIN, HIGH);
-      pumpState.outletPumpRunning = false;
-      pumpState.outletPumpWasActive = false;
-    }
+// A cleaning cycle owns the inlet/outlet: the controller sits it out in IDLE
+// and takes over a phase timeout as its own FAULT.
+void stepCleaning(uint8_t level) {
+  if (levelState != LevelState::IDLE)
+    enterLevelState(LevelState::IDLE, F("cleaning"), level);
+  if (!stepWaterCleaningCycle(level)) {
+    pumpState.currentError = WATER_ERROR_PUMP_TIMEOUT;
+    enterLevelState(LevelState::FAULT, F("cleaning timeout"), level);
   }
+}
 
-  return {WATER_ERROR_NONE, currentLevel, pumpState.inletPumpRunning, pumpState.outletPumpRunning};
+// Sensor error or calibration: the level cannot be trusted, so every
+// inlet/outlet pump stops (a FAULT stays latched).
+void holdLevelControl(const __FlashStringHelper* trigger, uint8_t level) {
+  if (levelState != LevelState::FAULT)
+    enterLevelState(LevelState::IDLE, trigger, level);
+  if (isWaterCleaningActive())
+    pauseWaterCleaningCycle();
 }
 
+// Sensor errors clear themselves with the next valid reading; only a pump
+// timeout stays latched until clearWaterError().
+void setSensorError(WaterError error) {
+  WaterError current = pumpState.currentError;
+  if (current == WATER_ERROR_PUMP_TIMEOUT || current == error)
+    return;
+  if (error == WATER_ERROR_NONE)
+    SerialPrint(WATER, "Sensor error cleared code=", current);
+  pumpState.currentError = error;
+}
 
-// ---------------------------------------------------------------------------
-// Cleaning cycle implementation
-// ---------------------------------------------------------------------------
+// Outcome of the SENSOR task, consumed here rather than read again.
+WaterError sensorError() {
+  WaterError error = waterSensor.getLastError();
+  if (error == WATER_ERROR_NONE && !waterSensor.isSensorConnected())
+    error = WATER_ERROR_SENSOR_TIMEOUT;
+  return error;
+}
 
-void runWaterCleaningCycle() {
-  SerialPrint(CONFIG, "Starting water cleaning cycle");
-
-  // drain until we hit or go below the low threshold
-  while (true) {
-    WaterError err = waterSensor.readSensorData();
-    if (err != WATER_ERROR_NONE) {
-      SerialPrint(CONFIG, "Sensor error during cleaning cycle: ", err);
-      break;
-    }
-    uint8_t lvl = waterSensor.calculateWaterLevel();
-    if (lvl <= AppState::lowThreshold) {
-      SerialPrint(CONFIG, "Reached low threshold (", lvl, "%), stopping outlet pump");
-      break;
-    }
-    uint16_t dur = calculatePumpDuration(lvl, AppState::lowThreshold);
-    runPumpSafely(Hardware::OUTLET_PUMP_PIN, dur);
-    delay(100);
-  }
+// Feeds each completed frame into the filter exactly once.
+void consumeFrame() {
+  uint16_t sequence = waterSensor.getFrame().sequence;
+  if (sequence == filteredSequence)
+    return;
+  filteredSequence = sequence;
+  updateLevelFilter(waterSensor);
+  stepSensorCalibration();
+}
 
-  // fill until we hit or exceed the high threshold
-  while (true) {
-    WaterError err = waterSensor.readSensorData();
-    if (err != WATER_ERROR_NONE) {
-      SerialPrint(CONFIG, "Sensor error during cleaning cycle: ", err);
-      break;
-    }
-    uint8_t lvl = waterSensor.calculateWaterLevel();
-    if (lvl >= AppState::highThreshold) {
-      SerialPrint(CONFIG, "Reached high threshold (", lvl, "%), stopping inlet pump");
-      break;
-    }
-    uint16_t dur = calculatePumpDuration(lvl, AppState::highThreshold);
-    runPumpSafely(Hardware::INLET_PUMP_PIN, dur);
-    delay(100);
+} // namespace
+
+WaterLevelResult checkWaterLevel() {
+  LATENCY_SPAN(LatencyProbe::CHECK_WATER_LEVEL);
+  WaterError error = sensorError();
+  setSensorError(error);
+  if (error != WATER_ERROR_NONE) {
+    holdLevelControl(F("sensor error"), 0); // Never keep a pump on blind
+    resetLevelFilter();
+    observeLetPumps(false);
+    lastLevelResult = levelResult(error, 0);
+    return lastLevelResult;
   }
 
-  SerialPrint(CONFIG, "Water cleaning cycle finished");
+  consumeFrame();
+  observeLetPumps(!isSensorCalibrating());
+  uint8_t currentLevel = getFilteredLevel();
+  if (isSensorCalibrating())
+    holdLevelControl(F("calibration"), currentLevel);
+  else if (isWaterCleaningActive())
+    stepCleaning(currentLevel);
+  else
+    stepLevelControl(currentLevel);
+
+  WaterError reported =
+      levelState == LevelState::FAULT ? WATER_ERROR_PUMP_TIMEOUT : WATER_ERROR_NONE;
+  lastLevelResult = levelResult(reported, currentLevel);
+  return lastLevelResult;
 }
 
+LevelState getLevelState() { return levelState; }
+
+WaterLevelResult getLastLevelResult() { return lastLevelResult; }
+
 // void controlElectrovalve(bool open) {
 //   if (open) {
 //     // digitalWrite(Hardware::ELECTROVALVE_PIN, LOW);
@@ -184,23 +246,30 @@ void runWaterCleaningCycle() {
 // bool isElectrovalveOpen() { return pumpState.electrovalveActive; }
 
 void emergencyStopLetPumps() {
-  digitalWrite(Hardware::INLET_PUMP_PIN, HIGH);
-  digitalWrite(Hardware::OUTLET_PUMP_PIN, HIGH);
-  pumpState.pumpActive = false;
+  if (levelState != LevelState::FAULT)
+    enterLevelState(LevelState::IDLE, F("emergency stop"), 0);
+  if (isWaterCleaningActive())
+    abortWaterCleaningCycle();
+  abortPumpRuns();
+  RelayManager::releaseAll();
 }
 
 void getPumpStatistics(uint32_t* inletRuntime, uint32_t* outletRuntime) {
   if (inletRuntime != NULL)
-    *inletRuntime = pumpState.inletPumpTotalRuntime;
+    *inletRuntime = RelayManager::onTimeMs(Hardware::INLET_PUMP_PIN);
   if (outletRuntime != NULL)
-    *outletRuntime = pumpState.outletPumpTotalRuntime;
+    *outletRuntime = RelayManager::onTimeMs(Hardware::OUTLET_PUMP_PIN);
 }
 
 void resetPumpStatistics() {
-  pumpState.inletPumpTotalRuntime = 0;
-  pumpState.outletPumpTotalRuntime = 0;
+  RelayManager::resetOnTime(Hardware::INLET_PUMP_PIN);
+  RelayManager::resetOnTime(Hardware::OUTLET_PUMP_PIN);
 }
 
 WaterError getWaterError() { return pumpState.currentError; }
-void clearWaterError() { pumpState.currentError = WATER_ERROR_NONE; }
+void clearWaterError() {
+  pumpState.currentError = WATER_ERROR_NONE;
+  if (levelState == LevelState::FAULT)
+    enterLevelState(LevelState::IDLE, F("cleared"), 0);
+}
 
@@ -0,0 +1,101 @@
+/**
+ * ============================================================================
+ * WATER_FILTER.CPP - Filtered Water Level and Trend
+ * ============================================================================
+ *
+ * Four O(1) stages per sensor frame:
+ *  1. Majority vote: a ring of the last LEVEL_VOTE_WINDOW touch masks with a
+ *     running per-pad count; a pad counts as wet if it was wet in most of
+ *     them, so one noisy frame cannot flip the level.
+ *  2. Interpolation: the voted waterline is refined from the raw readings
+ *     of the pads around it (WaterSensor::interpolateLevelQ8).
+ *  3. EMA of that level in 1/256 % fixed point.
+ *  4. Trend: EMA change over LEVEL_TREND_WINDOW_MS.
+ */
+
+#include "hardware.h"
+#include "water.h"
+#include <Arduino.h>
+#include <stdint.h>
+
+namespace {
+
+constexpr uint16_t Q8 = 256; // Fixed-point scale of the EMA
+constexpr uint8_t PAD_COUNT = WaterSensor::PAD_COUNT;
+
+WaterPadMask masks[Hardware::LEVEL_VOTE_WINDOW];
+uint8_t wetCount[PAD_COUNT]; // Frames in the ring in which each pad was wet
+uint8_t head = 0;            // Next ring slot to overwrite
+bool primed = false;
+
+uint16_t emaQ8 = 0;          // Filtered level, 1/256 %
+uint16_t anchorEmaQ8 = 0;    // EMA at the start of the trend window
+uint32_t anchorMs = 0;
+int16_t ratePerMinute = 0;   // Last completed trend window, 0.1 %/min
+
+// Replaces the oldest mask of the ring, keeping wetCount in step.
+void pushMask(const WaterPadMask &mask) {
+  const WaterPadMask &old = masks[head];
+  for (uint8_t pad = 0; pad < PAD_COUNT; pad++) {
+    wetCount[pad] += mask.test(pad);
+    wetCount[pad] -= old.test(pad);
+  }
+  masks[head] = mask;
+  head = (head + 1) % Hardware::LEVEL_VOTE_WINDOW;
+}
+
+WaterPadMask votedMask() {
+  WaterPadMask mask;
+  for (uint8_t pad = 0; pad < PAD_COUNT; pad++) {
+    if (wetCount[pad] * 2 > Hardware::LEVEL_VOTE_WINDOW)
+      mask.set(pad);
+  }
+  return mask;
+}
+
+void prime(const WaterPadMask &mask, uint16_t levelQ8, uint32_t now) {
+  for (uint8_t i = 0; i < Hardware::LEVEL_VOTE_WINDOW; i++)
+    masks[i] = mask;
+  for (uint8_t pad = 0; pad < PAD_COUNT; pad++)
+    wetCount[pad] = mask.test(pad) ? Hardware::LEVEL_VOTE_WINDOW : 0;
+  head = 0;
+  emaQ8 = levelQ8;
+  anchorEmaQ8 = emaQ8;
+  anchorMs = now;
+  ratePerMinute = 0;
+  primed = true;
+}
+
+void updateTrend(uint32_t now) {
+  uint32_t elapsedMs = now - anchorMs;
+  if (elapsedMs < Hardware::LEVEL_TREND_WINDOW_MS)
+    return;
+  // 0.1 %/min = deltaQ8 / 256 * 10 * 60000 / elapsedMs; 600000 / 256 = 2343.75
+  int32_t deltaQ8 = static_cast<int32_t>(emaQ8) - anchorEmaQ8;
+  ratePerMinute = static_cast<int16_t>(deltaQ8 * 2344L / static_cast<int32_t>(elapsedMs));
+  anchorEmaQ8 = emaQ8;
+  anchorMs = now;
+}
+
+} // namespace
+
+void updateLevelFilter(const WaterSensor &sensor) {
+  uint32_t now = millis();
+  WaterPadMask touchMask = sensor.readWaterLevelRaw();
+  if (!primed) {
+    prime(touchMask, sensor.calculateWaterLevelQ8(), now);
+    return;
+  }
+  pushMask(touchMask);
+  int32_t targetQ8 = sensor.interpolateLevelQ8(votedMask().countFromBottom());
+  emaQ8 = static_cast<uint16_t>(emaQ8 + ((targetQ8 - emaQ8) >> Hardware::LEVEL_EMA_SHIFT));
+  updateTrend(now);
+}
+
+void resetLevelFilter() { primed = false; }
+
+uint8_t getFilteredLevel() { return static_cast<uint8_t>((emaQ8 + Q8 / 2) / Q8); }
+
+uint16_t getFilteredLevelQ8() { return emaQ8; }
+
+int16_t levelRatePerMinute() { return primed ? ratePerMinute : 0; }
@@ -0,0 +1,252 @@
+/**
+ * ============================================================================
+ * WATER_RATE.CPP - Learned Inlet/Outlet Rate Model and Correction Pulses
+ * ============================================================================
+ *
+ * Learning: a sample starts when the inlet or outlet switches on from a
+ * settled level and ends LET_SETTLE_MS after it switched off again; the
+ * level change over the relay's measured on-time is one observation of that
+ * pump's rate (milli-percent per second). Observations blend into the
+ * stored estimate, which the PERSIST task writes back so it survives
+ * reboots.
+ *
+ * Pulses: once a pump's rate is known, a correction (level controller or
+ * cleaning phase) runs the pump for the time predicted to reach its
+ * threshold, waits for the level to settle and only then plans a trim
+ * pulse, so the filter lag no longer adds overshoot. An unknown rate runs
+ * the pump until the threshold is reached, which teaches the model.
+ */
+
+#include "debug.hpp"
+#include "hardware.h"
+#include "relay_manager.h"
+#include "storage.h"
+#include "water.h"
+#include <Arduino.h>
+#include <stdint.h>
+
+namespace {
+
+// Persisted estimate (EepromMap::LET_RATE_ADDR); 0 = not learned yet
+struct LetRateModel {
+  uint16_t inletRate;  // milli-percent per second
+  uint16_t outletRate;
+  uint8_t inletSamples;
+  uint8_t outletSamples;
+};
+
+enum class SampleState : uint8_t {
+  QUIET,   // Waiting for the level to settle after inlet/outlet activity
+  READY,   // Settled; the next single-pump run starts a sample
+  RUNNING, // Sampled pump on
+  SETTLING // Pump off again, waiting for the final level
+};
+
+LetRateModel model = {0, 0, 0, 0};
+bool modelDirty = false; // Learned since the last flushLetRateModel()
+
+SampleState sampleState = SampleState::QUIET;
+uint8_t samplePin = 0;
+uint16_t sampleStartQ8 = 0;   // Settled level before the run
+uint32_t sampleStartOnMs = 0; // Relay on-time counter at the start
+uint32_t sampleOnMs = 0;      // On-time of the finished run
+uint32_t quietSinceMs = 0;    // QUIET/SETTLING: last inlet/outlet activity
+
+bool pulseActive = false;
+bool pulseArmed = false; // Relay on, pulseEndMs counting
+bool openEnded = false; // Rate unknown: on until the threshold is reached
+uint32_t pulseMs = 0;    // Planned length, timed from the relay switching on
+uint32_t pulseEndMs = 0;
+uint8_t pulseCount = 0;
+
+uint16_t &rateOf(uint8_t pumpPin) {
+  return pumpPin == Hardware::INLET_PUMP_PIN ? model.inletRate : model.outletRate;
+}
+
+uint8_t &samplesOf(uint8_t pumpPin) {
+  return pumpPin == Hardware::INLET_PUMP_PIN ? model.inletSamples : model.outletSamples;
+}
+
+// Blends one observation into the estimate; the PERSIST task stores it.
+void learn(uint8_t pumpPin, uint32_t observed) {
+  uint16_t &rate = rateOf(pumpPin);
+  uint8_t &samples = samplesOf(pumpPin);
+  if (samples == 0)
+    rate = static_cast<uint16_t>(observed);
+  else
+    rate = static_cast<uint16_t>(
+        rate + ((static_cast<int32_t>(observed) - rate) >> Hardware::LET_RATE_GAIN_SHIFT));
+  if (samples != 0xFF)
+    samples++;
+  modelDirty = true;
+  SerialPrint(WATER, "Let rate learned pin=", pumpPin, " observedMilliPctPerSec=", observed,
+              " estimate=", rate, " samples=", samples);
+}
+
+// Level change over the run -> milli-percent per second, if it is usable.
+void finishSample(uint16_t levelQ8) {
+  bool filling = samplePin == Hardware::INLET_PUMP_PIN;
+  int32_t deltaQ8 = filling ? static_cast<int32_t>(levelQ8) - sampleStartQ8
+                            : static_cast<int32_t>(sampleStartQ8) - levelQ8;
+  if (deltaQ8 < Hardware::LET_LEARN_MIN_DELTA_Q8 || sampleOnMs < Hardware::LET_PULSE_MIN_MS) {
+    SerialPrint(WATER, "Let rate sample skipped pin=", samplePin, " deltaQ8=", deltaQ8,
+                " onMs=", sampleOnMs);
+    return;
+  }
+  // 1e6 / 256 = 15625 / 4; deltaQ8 <= 25600 keeps the product in 32 bits
+  uint32_t observed = static_cast<uint32_t>(deltaQ8) * 15625UL / 4UL / sampleOnMs;
+  if (observed == 0 || observed > 0xFFFFUL)
+    return;
+  learn(samplePin, observed);
+}
+
+// Single inlet/outlet pin that is on, 0 if none or both.
+uint8_t runningLetPump(bool inlet, bool outlet) {
+  if (inlet == outlet)
+    return 0;
+  return inlet ? Hardware::INLET_PUMP_PIN : Hardware::OUTLET_PUMP_PIN;
+}
+
+// On-time predicted to move the level LET_TARGET_MARGIN_Q8 past the threshold.
+uint32_t planPulseMs(uint8_t pumpPin, uint8_t targetPercent) {
+  bool filling = pumpPin == Hardware::INLET_PUMP_PIN;
+  int32_t aimQ8 = targetPercent * 256L +
+                  (filling ? Hardware::LET_TARGET_MARGIN_Q8 : -Hardware::LET_TARGET_MARGIN_Q8);
+  int32_t levelQ8 = getFilteredLevelQ8();
+  int32_t remainingQ8 = filling ? aimQ8 - levelQ8 : levelQ8 - aimQ8;
+  uint32_t pulseMs = remainingQ8 > 0 ? predictLetPumpMs(pumpPin, static_cast<uint16_t>(remainingQ8)) : 0;
+  SerialPrint(WATER, "Let pulse pin=", pumpPin, " n=", pulseCount + 1, " predictedMs=", pulseMs,
+              " levelQ8=", levelQ8, " aimQ8=", aimQ8);
+  return pulseMs < Hardware::LET_PULSE_MIN_MS ? Hardware::LET_PULSE_MIN_MS : pulseMs;
+}
+
+void startSample(uint8_t pumpPin, uint16_t levelQ8) {
+  samplePin = pumpPin;
+  sampleStartQ8 = levelQ8;
+  sampleStartOnMs = RelayManager::onTimeMs(pumpPin);
+  sampleState = SampleState::RUNNING;
+}
+
+// RUNNING: the sampled pump switched off (or the other one took over).
+void stopSample(uint8_t running, uint32_t now) {
+  if (running == samplePin)
+    return;
+  sampleOnMs = RelayManager::onTimeMs(samplePin) - sampleStartOnMs;
+  sampleState = running == 0 ? SampleState::SETTLING : SampleState::QUIET;
+  quietSinceMs = now;
+}
+
+// SETTLING: the level after LET_SETTLE_MS completes the sample.
+void settleSample(uint8_t running, uint32_t now, uint16_t levelQ8) {
+  if (running != 0) {
+    sampleState = SampleState::QUIET; // Restarted before the level settled
+    quietSinceMs = now;
+  } else if (now - quietSinceMs >= Hardware::LET_SETTLE_MS) {
+    finishSample(levelQ8);
+    sampleState = SampleState::READY;
+  }
+}
+
+} // namespace
+
+void initLetRateModel() {
+  if (!loadRecord(EepromMap::LET_RATE_ADDR, &model, sizeof(model))) {
+    model = LetRateModel{0, 0, 0, 0};
+    SerialPrint(WATER, "No inlet/outlet rates stored; learning from the next runs");
+    return;
+  }
+  printLetRateModel();
+}
+
+void observeLetPumps(bool levelValid) {
+  uint32_t now = millis();
+  bool inlet = RelayManager::isOn(Hardware::INLET_PUMP_PIN);
+  bool outlet = RelayManager::isOn(Hardware::OUTLET_PUMP_PIN);
+  if (!levelValid || (inlet && outlet)) {
+    sampleState = SampleState::QUIET; // Sample (if any) is lost
+    quietSinceMs = now;
+    return;
+  }
+  uint8_t running = runningLetPump(inlet, outlet);
+  uint16_t levelQ8 = getFilteredLevelQ8();
+  switch (sampleState) {
+  case SampleState::QUIET:
+    if (running != 0)
+      quietSinceMs = now;
+    else if (now - quietSinceMs >= Hardware::LET_SETTLE_MS)
+      sampleState = SampleState::READY;
+    break;
+  case SampleState::READY:
+    if (running != 0)
+      startSample(running, levelQ8);
+    break;
+  case SampleState::RUNNING:
+    stopSample(running, now);
+    break;
+  default: // SETTLING
+    settleSample(running, now, levelQ8);
+    break;
+  }
+}
+
+void flushLetRateModel() {
+  if (!modelDirty)
+    return;
+  modelDirty = false;
+  storeRecord(EepromMap::LET_RATE_ADDR, &model, sizeof(model));
+}
+
+uint32_t predictLetPumpMs(uint8_t pumpPin, uint16_t deltaQ8) {
+  uint16_t rate = rateOf(pumpPin);
+  if (samplesOf(pumpPin) == 0 || rate == 0)
+    return 0;
+  return static_cast<uint32_t>(deltaQ8) * 15625UL / 4UL / rate;
+}
+
+void beginLetCorrection() {
+  pulseActive = false;
+  openEnded = false;
+  pulseCount = 0;
+}
+
+bool stepLetCorrection(uint8_t pumpPin, uint8_t targetPercent) {
+  uint32_t now = millis();
+  if (openEnded)
+    return true;
+  if (pulseActive) {
+    // A relay queued behind the load budget has not started the pulse yet
+    if (!pulseArmed && RelayManager::isOn(pumpPin)) {
+      pulseArmed = true;
+      pulseEndMs = now + pulseMs;
+    }
+    if (!pulseArmed || static_cast<int32_t>(now - pulseEndMs) < 0)
+      return true;
+    pulseActive = false;
+  }
+  if (sampleState != SampleState::READY)
+    return false; // Every run starts from a settled level
+  if (samplesOf(pumpPin) == 0) {
+    openEnded = true;
+    SerialPrint(WATER, "Let run pin=", pumpPin, " rate unknown; on until the threshold");
+    return true;
+  }
+  pulseActive = true;
+  pulseArmed = false;
+  pulseMs = planPulseMs(pumpPin, targetPercent);
+  if (pulseCount != 0xFF)
+    pulseCount++;
+  return true;
+}
+
+void resetLetRateModel() {
+  model = LetRateModel{0, 0, 0, 0};
+  modelDirty = false;
+  eraseRecord(EepromMap::LET_RATE_ADDR, sizeof(model));
+  SerialPrint(WATER, "Inlet/outlet rate model reset");
+}
+
+void printLetRateModel() {
+  SerialPrint(WATER, "letRate inletMilliPctPerSec=", model.inletRate, " samples=",
+              model.inletSamples, " outletMilliPctPerSec=", model.outletRate, " samples=",
+              model.outletSamples);
+}
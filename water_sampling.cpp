@@ -0,0 +1,86 @@
+/**
+ * ============================================================================
+ * WATER_SAMPLING.CPP - Adaptive Sensor Sampling Rate
+ * ============================================================================
+ *
+ * The level only changes while a pump moves water, so the SENSOR task runs
+ * at full rate only then and drops to a heartbeat otherwise, leaving the
+ * I2C bus and CPU to the LCD and keypad. Mode changes are logged; frame
+ * rate and bus occupancy are measured per window for the console report.
+ */
+
+#include "debug.hpp"
+#include "hardware.h"
+#include "relay_manager.h"
+#include "scheduler.h"
+#include "water.h"
+#include <Arduino.h>
+#include <stdint.h>
+
+extern WaterSensor waterSensor;
+
+static_assert(Hardware::SENSOR_FRAME_MAX_AGE_MS > 2 * Hardware::TASK_SENSOR_SLOW_PERIOD_MS,
+              "a slow-rate frame (two SENSOR ticks) must not count as lost");
+
+namespace {
+
+SamplingStats stats = {SamplingMode::FAST, 0, 0, 0};
+uint32_t lastBusyMs = 0; // millis() when fast sampling was last needed
+
+uint32_t windowStartMs = 0;
+uint16_t windowStartSequence = 0;
+uint32_t windowStartBusUs = 0;
+
+const __FlashStringHelper* modeName(SamplingMode mode) {
+  return mode == SamplingMode::FAST ? F("FAST") : F("SLOW");
+}
+
+// Water moving, or a failing sensor whose recovery should be seen quickly.
+bool needsFastSampling() {
+  int16_t rate = levelRatePerMinute();
+  return waterSensor.getLastError() != WATER_ERROR_NONE ||
+         RelayManager::isOn(Hardware::INLET_PUMP_PIN) ||
+         RelayManager::isOn(Hardware::OUTLET_PUMP_PIN) || isWaterCleaningActive() ||
+         rate > Hardware::LEVEL_STABLE_RATE || rate < -Hardware::LEVEL_STABLE_RATE;
+}
+
+void enterMode(SamplingMode next, uint32_t now) {
+  if (next == stats.mode)
+    return;
+  SerialPrint(WATER, "Sensor sampling ", modeName(stats.mode), " -> ", modeName(next),
+              " trendTenthsPerMin=", levelRatePerMinute(), " quietMs=", now - lastBusyMs);
+  stats.mode = next;
+  if (stats.modeChanges != 0xFFFF)
+    stats.modeChanges++;
+  Scheduler::setTaskPeriod(TaskId::SENSOR, next == SamplingMode::FAST
+                                               ? Hardware::TASK_SENSOR_PERIOD_MS
+                                               : Hardware::TASK_SENSOR_SLOW_PERIOD_MS);
+}
+
+// Frame rate and bus share over the window that just ended.
+void rollWindow(uint32_t now) {
+  uint32_t elapsedMs = now - windowStartMs;
+  if (elapsedMs < Hardware::SAMPLING_STATS_WINDOW_MS)
+    return;
+  uint16_t sequence = waterSensor.getFrame().sequence;
+  uint32_t busUs = waterSensor.getBusBusyUs();
+  uint16_t frames = static_cast<uint16_t>(sequence - windowStartSequence);
+  stats.framesPerMinute = static_cast<uint16_t>(frames * 60000UL / elapsedMs);
+  stats.busPermille = static_cast<uint16_t>((busUs - windowStartBusUs) / elapsedMs);
+  windowStartMs = now;
+  windowStartSequence = sequence;
+  windowStartBusUs = busUs;
+}
+
+} // namespace
+
+void updateSensorSampling() {
+  uint32_t now = millis();
+  if (needsFastSampling())
+    lastBusyMs = now;
+  bool holdFast = now - lastBusyMs < Hardware::SENSOR_FAST_HOLD_MS;
+  enterMode(holdFast ? SamplingMode::FAST : SamplingMode::SLOW, now);
+  rollWindow(now);
+}
+
+SamplingStats getSamplingStats() { return stats; }
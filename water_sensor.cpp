@@ -7,123 +7,202 @@
 #include "water.h"
 #include "hardware.h"
 #include "debug.hpp"
+#include "i2c_bus.h"
 #include <Arduino.h>
-#include <Wire.h>
 
-// Static member variable definition
-bool WaterSensor::initialized = false;
+// Bottom-up chip table of the tank's sensor
+static constexpr SensorChip WATER_SENSOR_CHIPS[Hardware::WATER_SENSOR_CHIP_COUNT] = {
+  {I2cDevice::SENSOR_LOW, Hardware::WATER_SENSOR_LOW_ADDR, Hardware::WATER_SENSOR_LOW_PADS},
+  {I2cDevice::SENSOR_HIGH, Hardware::WATER_SENSOR_HIGH_ADDR, Hardware::WATER_SENSOR_HIGH_PADS},
+};
 
-// Global instance of WaterSensor
-WaterSensor waterSensor;
-
-WaterSensor::WaterSensor() {
-  if (initialized) return;
-  initialized = true;
-  memset(high_data, 0, sizeof(high_data));
-  memset(low_data, 0, sizeof(low_data));
-  lastError = WATER_ERROR_NONE;
-  lastSuccessfulRead = 0;
-  sensorConnected = false;
-}
-
-WaterError WaterSensor::readSensorData() {
-  unsigned long startTime = millis();
-
-  // Read low sensor
-  memset(low_data, 0, sizeof(low_data));
-  Wire.requestFrom(static_cast<uint8_t>(Hardware::WATER_SENSOR_LOW_ADDR), static_cast<uint8_t>(8));
-  while (8 != Wire.available()) {
-    if (millis() - startTime > Hardware::SENSOR_READ_TIMEOUT_MS) {
-      lastError = WATER_ERROR_SENSOR_TIMEOUT;
-      sensorConnected = false;
-      return lastError;
-    }
+// Pads of the table entries from `from` on
+template <uint8_t ChipCount>
+static constexpr uint16_t chipPadTotal(const SensorChip (&table)[ChipCount], uint8_t from = 0) {
+  return from >= ChipCount ? 0 : table[from].pads + chipPadTotal(table, from + 1);
+}
+
+static_assert(chipPadTotal(WATER_SENSOR_CHIPS) == Hardware::SENSOR_PAD_COUNT,
+              "chip pads must add up to the array's pad count");
+
+template <uint8_t PadCount, uint8_t ChipCount>
+TouchSensorArray<PadCount, ChipCount>::TouchSensorArray(const SensorChip (&chipTable)[ChipCount]) {
+  memcpy(chips, chipTable, sizeof(chips));
+  memset(&frame, 0, sizeof(frame));
+  frame.error = WATER_ERROR_SENSOR_TIMEOUT; // Nothing acquired yet
+  memset(back, 0, sizeof(back));
+  nextChip = 0;
+  nextPad = 0;
+  busBusyUs = 0;
+  resetPadReferences();
+}
+
+// One bus transfer into `buf`. Wire completes the transfer inside
+// requestFrom() (~1 ms for 12 bytes at 100 kHz), so the received count is
+// final once it returns; there is nothing to wait for afterwards.
+static WaterError readPad(I2cDevice device, uint8_t address, uint8_t *buf, uint8_t len) {
+  uint8_t received = I2cBus::read(device, address, buf, len);
+  if (received == len) return WATER_ERROR_NONE;
+  return received == 0 ? WATER_ERROR_SENSOR_TIMEOUT : WATER_ERROR_SENSOR_COMMUNICATION;
+}
+
+// Ends the frame in progress: publishes `error`, or validates the back
+// buffer and swaps it into the cached frame.
+template <uint8_t PadCount, uint8_t ChipCount>
+void TouchSensorArray<PadCount, ChipCount>::completeFrame(WaterError error) {
+  nextChip = 0;
+  nextPad = 0;
+  if (error == WATER_ERROR_NONE) {
+    bool validData = false;
+    for (uint8_t pad = 0; pad < PadCount; pad++) if (back[pad] != 0) validData = true;
+    if (!validData) error = WATER_ERROR_SENSOR_INVALID_DATA;
   }
-  for (int i = 0; i < 8; i++) low_data[i] = Wire.read();
-
-  // Read high sensor
-  memset(high_data, 0, sizeof(high_data));
-  Wire.requestFrom(static_cast<uint8_t>(Hardware::WATER_SENSOR_HIGH_ADDR), static_cast<uint8_t>(12));
-  while (12 != Wire.available()) {
-    if (millis() - startTime > Hardware::SENSOR_READ_TIMEOUT_MS) {
-      lastError = WATER_ERROR_SENSOR_TIMEOUT;
-      sensorConnected = false;
-      return lastError;
-    }
+  if (error == WATER_ERROR_NONE) {
+    memcpy(frame.pads, back, sizeof(frame.pads));
+    frame.takenAtMs = millis();
   }
-  for (int i = 0; i < 12; i++) high_data[i] = Wire.read();
+  frame.error = error;
+  frame.sequence++;
+}
 
-  delay(10); // Small delay for stability
+template <uint8_t PadCount, uint8_t ChipCount>
+WaterError TouchSensorArray<PadCount, ChipCount>::pollAcquisition() {
+  uint32_t startUs = micros();
+  const SensorChip &chip = chips[nextChip];
+  WaterError error = readPad(chip.device, chip.address, back + nextPad, chip.pads);
+  if (error != WATER_ERROR_NONE || nextChip + 1 >= ChipCount) {
+    completeFrame(error);
+  } else {
+    nextPad += chip.pads;
+    nextChip++;
+  }
+  busBusyUs += micros() - startUs;
+  return frame.error;
+}
 
-  bool validData = false;
-  for (int i = 0; i < 8; i++) if (low_data[i] != 0) validData = true;
-  for (int i = 0; i < 12; i++) if (high_data[i] != 0) validData = true;
+template <uint8_t PadCount, uint8_t ChipCount>
+WaterError TouchSensorArray<PadCount, ChipCount>::readSensorData() {
+  nextChip = 0;
+  nextPad = 0;
+  uint16_t before = frame.sequence;
+  while (frame.sequence == before) pollAcquisition();
+  return frame.error;
+}
 
-  if (!validData) {
-    lastError = WATER_ERROR_SENSOR_INVALID_DATA;
-    sensorConnected = false;
-    return lastError;
-  }
+template <uint8_t PadCount, uint8_t ChipCount>
+const SensorFrame<PadCount> &TouchSensorArray<PadCount, ChipCount>::acquireFrame(uint16_t maxAgeMs) {
+  if (!isFrameFresh(maxAgeMs))
+    readSensorData();
+  return frame;
+}
 
-  lastError = WATER_ERROR_NONE;
-  lastSuccessfulRead = millis();
-  sensorConnected = true;
-  return lastError;
+template <uint8_t PadCount, uint8_t ChipCount>
+const SensorFrame<PadCount> &TouchSensorArray<PadCount, ChipCount>::getFrame() const {
+  return frame;
 }
 
-uint8_t WaterSensor::getTouchedSections() {
-  readSensorData();
-  uint32_t touch_val = 0;
-  uint8_t trig_section = 0;
-  for (int i = 0; i < 8; i++) if (low_data[i] > Hardware::TOUCH_THRESHOLD) touch_val |= 1 << i;
-  for (int i = 0; i < 12; i++) if (high_data[i] > Hardware::TOUCH_THRESHOLD) touch_val |= static_cast<uint32_t>(1) << (8 + i);
-  while (touch_val & 0x01) { trig_section++; touch_val >>= 1; }
-  return trig_section;
+template <uint8_t PadCount, uint8_t ChipCount>
+uint32_t TouchSensorArray<PadCount, ChipCount>::getBusBusyUs() const { return busBusyUs; }
+
+template <uint8_t PadCount, uint8_t ChipCount>
+bool TouchSensorArray<PadCount, ChipCount>::isFrameFresh(uint16_t maxAgeMs) const {
+  return frame.error == WATER_ERROR_NONE && millis() - frame.takenAtMs <= maxAgeMs;
 }
 
-uint8_t WaterSensor::calculateWaterLevel() {
-  uint8_t sections = getTouchedSections();
-  return (sections * 5);
+// Evaluates the latest completed frame; does not touch the bus.
+template <uint8_t PadCount, uint8_t ChipCount>
+uint8_t TouchSensorArray<PadCount, ChipCount>::getTouchedSections() const {
+  return readWaterLevelRaw().countFromBottom();
 }
 
-uint32_t WaterSensor::readWaterLevelRaw() {
-  readSensorData();
-  uint32_t touch_val = 0;
-  for (int i = 0; i < 8; i++) if (low_data[i] > Hardware::TOUCH_THRESHOLD) touch_val |= 1 << i;
-  for (int i = 0; i < 12; i++) if (high_data[i] > Hardware::TOUCH_THRESHOLD) touch_val |= static_cast<uint32_t>(1) << (8 + i);
-  return touch_val;
+template <uint8_t PadCount, uint8_t ChipCount>
+uint8_t TouchSensorArray<PadCount, ChipCount>::calculateWaterLevel() const {
+  return static_cast<uint8_t>(getTouchedSections() * 100U / PadCount);
 }
 
-void WaterSensor::getCurrentWaterLevel(uint8_t *highBuf, uint8_t *lowBuf) {
-  readSensorData();
-  if (highBuf != NULL) memcpy(highBuf, high_data, 12);
-  if (lowBuf != NULL) memcpy(lowBuf, low_data, 8);
+template <uint8_t PadCount, uint8_t ChipCount>
+uint16_t TouchSensorArray<PadCount, ChipCount>::calculateWaterLevelQ8() const {
+  return interpolateLevelQ8(getTouchedSections());
 }
 
-WaterError WaterSensor::getLastError() const { return lastError; }
+template <uint8_t PadCount, uint8_t ChipCount>
+uint8_t TouchSensorArray<PadCount, ChipCount>::padValue(uint8_t pad) const {
+  return pad < PadCount ? frame.pads[pad] : 0;
+}
 
-bool WaterSensor::calibrateSensor(uint8_t sensorType, uint8_t *referenceData) {
-  if (referenceData == NULL) return false;
-  uint8_t calibrationReadings = 5;
-  uint32_t sumLow[8] = { 0 }, sumHigh[12] = { 0 };
+template <uint8_t PadCount, uint8_t ChipCount>
+uint16_t TouchSensorArray<PadCount, ChipCount>::padCoverageQ8(uint8_t pad) const {
+  uint8_t value = padValue(pad);
+  if (value <= padDry[pad]) return 0;
+  if (value >= padWet[pad]) return 256;
+  return static_cast<uint16_t>((value - padDry[pad]) * 256U / (padWet[pad] - padDry[pad]));
+}
 
-  for (int i = 0; i < calibrationReadings; i++) {
-    if (readSensorData() != WATER_ERROR_NONE) return false;
-    for (int j = 0; j < 8; j++) sumLow[j] += low_data[j];
-    for (int j = 0; j < 12; j++) sumHigh[j] += high_data[j];
-    delay(100);
-  }
+// Of the pads just below and just above the waterline, the one that is
+// partly submerged adds its fraction; the other reads full or empty, so
+// the sum stays continuous when the touch count steps.
+template <uint8_t PadCount, uint8_t ChipCount>
+uint16_t TouchSensorArray<PadCount, ChipCount>::interpolateLevelQ8(uint8_t sections) const {
+  if (sections > PadCount) sections = PadCount;
+  uint16_t padsQ8 = 0;
+  if (sections > 0) padsQ8 = (sections - 1) * 256U + padCoverageQ8(sections - 1);
+  if (sections < PadCount) padsQ8 += padCoverageQ8(sections);
+  uint16_t nextStepQ8 = (sections + 1) * 256U;
+  if (padsQ8 >= nextStepQ8) padsQ8 = nextStepQ8 - 1; // Pad above read wet, not voted
+  return static_cast<uint16_t>(padsQ8 * 100UL / PadCount);
+}
 
-  if (sensorType == 0) {
-    for (int i = 0; i < 8; i++) referenceData[i] = sumLow[i] / calibrationReadings;
-    return true;
-  } else if (sensorType == 1) {
-    for (int i = 0; i < 12; i++) referenceData[i] = sumHigh[i] / calibrationReadings;
-    return true;
-  }
-  return false;
+template <uint8_t PadCount, uint8_t ChipCount>
+PadMask<PadCount> TouchSensorArray<PadCount, ChipCount>::readWaterLevelRaw() const {
+  Mask touched;
+  for (uint8_t pad = 0; pad < PadCount; pad++)
+    if (frame.pads[pad] > padThreshold[pad]) touched.set(pad);
+  return touched;
+}
+
+template <uint8_t PadCount, uint8_t ChipCount>
+bool TouchSensorArray<PadCount, ChipCount>::setPadReference(uint8_t pad, uint8_t dry, uint8_t wet) {
+  if (pad >= PadCount || wet <= dry) return false;
+  padDry[pad] = dry;
+  padWet[pad] = wet;
+  padThreshold[pad] = dry + (wet - dry) / 2;
+  return true;
+}
+
+template <uint8_t PadCount, uint8_t ChipCount>
+void TouchSensorArray<PadCount, ChipCount>::getPadReference(uint8_t pad, uint8_t *dry,
+                                                            uint8_t *wet) const {
+  if (pad >= PadCount) return;
+  *dry = padDry[pad];
+  *wet = padWet[pad];
 }
 
-bool WaterSensor::isSensorConnected() const {
-  return sensorConnected && (millis() - lastSuccessfulRead < Hardware::SENSOR_READ_TIMEOUT_MS * 3);
+template <uint8_t PadCount, uint8_t ChipCount>
+void TouchSensorArray<PadCount, ChipCount>::resetPadReferences() {
+  memset(padDry, Hardware::PAD_DRY_REFERENCE, sizeof(padDry));
+  memset(padWet, Hardware::PAD_WET_REFERENCE, sizeof(padWet));
+  memset(padThreshold, Hardware::TOUCH_THRESHOLD, sizeof(padThreshold));
 }
+
+template <uint8_t PadCount, uint8_t ChipCount>
+uint8_t TouchSensorArray<PadCount, ChipCount>::copyChipPads(uint8_t chip, uint8_t *buf) const {
+  if (chip >= ChipCount || buf == NULL) return 0;
+  uint8_t first = 0;
+  for (uint8_t i = 0; i < chip; i++) first += chips[i].pads;
+  memcpy(buf, frame.pads + first, chips[chip].pads);
+  return chips[chip].pads;
+}
+
+template <uint8_t PadCount, uint8_t ChipCount>
+WaterError TouchSensorArray<PadCount, ChipCount>::getLastError() const { return frame.error; }
+
+template <uint8_t PadCount, uint8_t ChipCount>
+bool TouchSensorArray<PadCount, ChipCount>::isSensorConnected() const {
+  return isFrameFresh();
+}
+
+// Every array the firmware uses is instantiated here
+template class TouchSensorArray<Hardware::SENSOR_PAD_COUNT, Hardware::WATER_SENSOR_CHIP_COUNT>;
+
+// Global instance of WaterSensor
+WaterSensor waterSensor(WATER_SENSOR_CHIPS);
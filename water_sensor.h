@@ -0,0 +1,161 @@
+/**
+ * ============================================================================
+ * WATER_SENSOR.H - Touch Pad Sensor Array
+ * ============================================================================
+ *
+ * A water sensor is a vertical stack of capacitive pads read over I2C from
+ * one or more chips, each returning one byte per pad. TouchSensorArray is
+ * sized at compile time by its pad and chip count; the chips (bus device,
+ * address, pads) are passed in bottom-up order when the array is built, so
+ * a taller tank or a second stack on the same board is a new chip table
+ * and instantiation rather than new code. Touch masks are PadMask bit sets
+ * of the same size, so the pad count is not limited by a machine word.
+ *
+ * Member functions are defined in water_sensor.cpp and instantiated there
+ * for each array the firmware uses (WaterSensor).
+ */
+
+#ifndef WATER_SENSOR_H
+#define WATER_SENSOR_H
+
+#include <stdint.h>
+#include <string.h>
+#include "hardware.h"
+#include "i2c_bus.h"
+
+// Error codes for water management
+enum WaterError {
+  WATER_ERROR_NONE = 0,
+  WATER_ERROR_SENSOR_TIMEOUT = 1,
+  WATER_ERROR_SENSOR_COMMUNICATION = 2,
+  WATER_ERROR_SENSOR_INVALID_DATA = 3,
+  WATER_ERROR_PUMP_TIMEOUT = 4
+};
+
+// One sensor chip: its bus device (for arbitration and statistics), I2C
+// address and number of pads, the lowest pad first
+struct SensorChip {
+  I2cDevice device;
+  uint8_t address;
+  uint8_t pads;
+};
+
+// Fixed-size set of pad flags, bit 0 = bottom pad
+template <uint8_t Bits>
+class PadMask {
+public:
+  static constexpr uint8_t BYTES = (Bits + 7) / 8;
+
+  PadMask() { clear(); }
+  void clear() { memset(bytes, 0, BYTES); }
+  void set(uint8_t bit) { bytes[bit >> 3] |= static_cast<uint8_t>(1U << (bit & 7)); }
+  bool test(uint8_t bit) const { return (bytes[bit >> 3] >> (bit & 7)) & 1U; }
+
+  // Contiguous set bits from the bottom; the first clear bit ends the count
+  uint8_t countFromBottom() const {
+    uint8_t count = 0;
+    while (count < Bits && test(count)) count++;
+    return count;
+  }
+
+  bool operator==(const PadMask &other) const { return memcmp(bytes, other.bytes, BYTES) == 0; }
+  bool operator!=(const PadMask &other) const { return !(*this == other); }
+
+private:
+  uint8_t bytes[BYTES];
+};
+
+// Cached result of the sensor acquisition: the latest good pad data plus
+// the outcome of the most recent frame. Every consumer (level control, raw
+// mask, diagnostics, calibration) reads this instead of the bus.
+template <uint8_t PadCount>
+struct SensorFrame {
+  uint8_t pads[PadCount]; // Pad values of the latest good frame, bottom first
+  uint32_t takenAtMs;     // millis() when the latest good frame completed
+  uint16_t sequence;      // Completed frames (good or failed), wraps
+  WaterError error;       // Outcome of the most recent frame
+};
+
+// Encapsulates touch pad data and reading logic
+//
+// Acquisition is split-phase: each pollAcquisition() call performs one chip
+// transfer into a back buffer, and a frame is only swapped into the cached
+// SensorFrame once every chip, bottom to top, succeeded. Readers always see
+// the latest complete frame and never touch the bus.
+template <uint8_t PadCount, uint8_t ChipCount>
+class TouchSensorArray {
+public:
+  static constexpr uint8_t PAD_COUNT = PadCount;
+  typedef PadMask<PadCount> Mask;
+  typedef SensorFrame<PadCount> Frame;
+
+  /**
+   * @param chips Chip table, bottom chip first; its pads must add up to
+   *              PadCount (checked where the table is defined)
+   */
+  explicit TouchSensorArray(const SensorChip (&chips)[ChipCount]);
+  WaterError pollAcquisition();  // One chip transfer; completes a frame after the last chip
+  WaterError readSensorData();   // Whole fresh frame now (maintenance paths only)
+  /**
+   * Cached frame, refreshed by a blocking read only if it is older than
+   * `maxAgeMs` or failed.
+   */
+  const Frame &acquireFrame(uint16_t maxAgeMs = Hardware::SENSOR_FRAME_MAX_AGE_MS);
+  const Frame &getFrame() const;
+  uint32_t getBusBusyUs() const; // Total time spent in pad transfers, wraps
+  bool isFrameFresh(uint16_t maxAgeMs = Hardware::SENSOR_FRAME_MAX_AGE_MS) const;
+  uint8_t getTouchedSections() const;
+  uint8_t calculateWaterLevel() const;
+  /**
+   * Level with sub-pad resolution from the latest frame, in 1/256 %.
+   * See interpolateLevelQ8().
+   */
+  uint16_t calculateWaterLevelQ8() const;
+  /**
+   * Level for a given count of contiguous wet pads, refined by the raw
+   * readings of the two pads around the waterline: each covers
+   * 100/PadCount % and contributes its reading's position between its dry
+   * and wet reference.
+   * @param sections Contiguous wet pads from the bottom (0-PadCount)
+   * @return Level in 1/256 % (0-25600)
+   */
+  uint16_t interpolateLevelQ8(uint8_t sections) const;
+  Mask readWaterLevelRaw() const;
+  /**
+   * Reference readings of one pad in air and fully submerged, used by the
+   * interpolation; the pad counts as wet above their midpoint. Every pad
+   * starts at PAD_DRY_REFERENCE/PAD_WET_REFERENCE with TOUCH_THRESHOLD.
+   * @return false for an invalid pad or wet <= dry
+   */
+  bool setPadReference(uint8_t pad, uint8_t dry, uint8_t wet);
+  void getPadReference(uint8_t pad, uint8_t *dry, uint8_t *wet) const;
+  void resetPadReferences();
+  uint8_t padValue(uint8_t pad) const; // Latest frame, pad 0 = bottom
+  /**
+   * Copy one chip's pads of the latest frame into `buf`.
+   * @return Pads copied (0 for an invalid chip)
+   */
+  uint8_t copyChipPads(uint8_t chip, uint8_t *buf) const;
+  WaterError getLastError() const;
+  bool isSensorConnected() const;
+
+private:
+  void completeFrame(WaterError error);
+  uint16_t padCoverageQ8(uint8_t pad) const; // 0 (dry) .. 256 (submerged)
+
+  SensorChip chips[ChipCount];
+  Frame frame;                 // Latest complete frame
+  uint8_t back[PadCount];      // Frame being acquired
+  uint8_t nextChip;            // Chip the next transfer reads
+  uint8_t nextPad;             // Its first pad in `back`
+  uint32_t busBusyUs;
+  uint8_t padDry[PadCount];    // Interpolation references per pad
+  uint8_t padWet[PadCount];
+  uint8_t padThreshold[PadCount]; // Wet above this reading
+};
+
+// The tank's sensor: low chip (8 pads) under the high chip (12 pads)
+typedef TouchSensorArray<Hardware::SENSOR_PAD_COUNT, Hardware::WATER_SENSOR_CHIP_COUNT> WaterSensor;
+typedef WaterSensor::Mask WaterPadMask;
+
+#endif // WATER_SENSOR_H
@@ -16,9 +16,14 @@ extern WaterSensor waterSensor;
 
 uint8_t calculateWaterLevel() { return waterSensor.calculateWaterLevel(); }
 
+void sampleWaterSensor() { waterSensor.pollAcquisition(); }
+
 uint16_t calculatePumpDuration(uint8_t currentLevel, uint8_t target) {
   uint8_t deviation = abs(currentLevel - target);
-  uint16_t duration = 1000 + (deviation * 100);
+  uint8_t pumpPin = target > currentLevel ? Hardware::INLET_PUMP_PIN : Hardware::OUTLET_PUMP_PIN;
+  uint32_t duration = predictLetPumpMs(pumpPin, deviation * 256U);
+  if (duration == 0)
+    duration = 1000 + (deviation * 100);
   if (duration > Hardware::MAX_PUMP_RUN_TIME_MS)
     duration = Hardware::MAX_PUMP_RUN_TIME_MS;
   return duration;
@@ -46,7 +51,6 @@ void displayWaterLevelStatus(const WaterLevelResult& result) {
       lcdPrintWithGlyphs(LANG_BUFFER.error.unknownError, LANG_WATER_ERROR_LEN, 0, 1);
       break;
     }
-    delay(Hardware::UI_DELAY_MEDIUM_MS);
   } else {
     lcdPrintWithGlyphs(LANG_BUFFER.status.waterLevel, LANG_WATER_ERROR_LEN, 0, 0);
     lcd.print(result.level);
@@ -67,14 +71,14 @@ int16_t getHighThreshold() { return AppState::highThreshold; }
 void setLowThreshold(uint16_t threshold) {
   if (threshold < AppState::highThreshold) {
     AppState::lowThreshold = threshold;
-    saveAppStateToConfiguration();
+    requestConfigurationSave();
   }
 }
 
 void setHighThreshold(uint16_t threshold) {
   if (threshold > AppState::lowThreshold && threshold <= 100) {
     AppState::highThreshold = threshold;
-    saveAppStateToConfiguration();
+    requestConfigurationSave();
   }
 }
 
@@ -82,35 +86,19 @@ void setWaterThresholds(int16_t low, int16_t high) {
   if (low >= 0 && high <= 100 && low < high) {
     AppState::lowThreshold = low;
     AppState::highThreshold = high;
-    saveAppStateToConfiguration();
+    requestConfigurationSave();
   }
 }
 
 void getCurrentWaterLevel(uint8_t* highBuf, uint8_t* lowBuf) {
-  waterSensor.getCurrentWaterLevel(highBuf, lowBuf);
+  waterSensor.copyChipPads(1, highBuf);
+  waterSensor.copyChipPads(0, lowBuf);
 }
 
 void read_water_sensor(uint8_t* highBuf, uint8_t* lowBuf) {
-  waterSensor.getCurrentWaterLevel(highBuf, lowBuf);
+  getCurrentWaterLevel(highBuf, lowBuf);
 }
 
 bool checkSensorHealth() {
-  return waterSensor.readSensorData() == WATER_ERROR_NONE && waterSensor.isSensorConnected();
-}
-
-void handleManualPumpControl(uint8_t idx) {
-  lcd.clear();
-  lcd.setCursor(0, 0);
-  lcd.print("Manual Pump Ctrl");
-  lcd.setCursor(0, 1);
-  lcd.print(idx + 1);
-
-  SerialPrint(PUMPS, "Manual pump control for pump ", idx);
-  delay(1000);
-  digitalWrite(Hardware::DOSING_PUMP_PINS[idx], LOW);
-  while (!keypad.getKey()) {
-    delay(10);
-  }
-  digitalWrite(Hardware::DOSING_PUMP_PINS[idx], HIGH);
-  SerialPrint(PUMPS, "Manual pump control for pump ", idx, " stopped by user");
+  return waterSensor.getLastError() == WATER_ERROR_NONE && waterSensor.isSensorConnected();
 }